@@ -0,0 +1,68 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CMarkdown.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static const int Repeats = 20; // number of formattings of every line (the fastest one is printed)
+
+/**
+ * @return Line of given length made by repeating given pattern.
+ */
+static std::wstring repeat(const std::wstring & pattern, size_t len) {
+    std::wstring line;
+    while (line.size() < len)
+        line += pattern;
+    line.resize(len);
+    return line;
+}
+
+/**
+ * @return Microseconds taken by the fastest of Repeats formattings of given line.
+ */
+static double measure(const std::wstring & line, std::vector<CFormat::TSpan> & spans) {
+    double best = 0;
+    for (int i = 0; i < Repeats; ++i) {
+        CMarkdown markdown; // spans of formatted lines are cached, so every formatting needs new one
+        auto start = std::chrono::steady_clock::now();
+        markdown.lineSpans(CTextStorage::TLineView{line.data(), line.size()}, 0, spans);
+        auto time = std::chrono::steady_clock::now() - start;
+        double micros = std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / 1000.0;
+        if (i == 0 || micros < best)
+            best = micros;
+    }
+    return best;
+}
+
+/**
+ * Formats lines full of emphasis dividers ('*' and '_'), which used to make CMarkdown::boldItalic() quadratic to cubic
+ * in their number. Time per char has to stay the same as lines get longer.
+ */
+int main() {
+    const std::vector<std::wstring> patterns = {L"*a", L"**a", L"*_", L"a* *a ", L"| * | ** | _ | ",
+                                                L"lorem/*ipsum*/**dolor** "};
+    const std::vector<size_t> lengths = {1000, 4000, 16000, 64000};
+    std::vector<CFormat::TSpan> spans;
+
+    printf("%-36s", "line (length in chars)");
+    for (size_t len : lengths)
+        printf(" %11zu", len);
+    printf("\n");
+    for (const auto & pattern : patterns) {
+        std::string label = "\"" + std::string(pattern.begin(), pattern.end()) + "\" repeated";
+        printf("%-36s", label.c_str());
+        double micros = 0;
+        for (size_t len : lengths) {
+            micros = measure(repeat(pattern, len), spans);
+            printf(" %8.0f us", micros);
+        }
+        printf("   (%.0f ns per char)\n", micros * 1000 / lengths.back());
+    }
+    return 0;
+}
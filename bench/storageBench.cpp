@@ -0,0 +1,159 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CPieceTable.h"
+#include "CRope.h"
+#include "CMappedFile.h"
+#include "CLoader.h"
+#include "CConverter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static const int Repeats = 1000; // number of repetitions of every operation (typing continues on the same line)
+static const size_t ScreenLines = 60;
+
+/**
+ * Text stored the way CTextStorage stored it originally: one std::wstring per line.
+ */
+class CLineVector {
+public:
+    bool load(const std::string & fileName) {
+        std::ifstream file(fileName);
+        if (!file)
+            return false;
+        std::string line;
+        while (std::getline(file, line))
+            m_Lines.push_back(CConverter::toWString(line));
+        if (m_Lines.empty())
+            m_Lines.emplace_back();
+        return true;
+    }
+    size_t lineCount() const { return m_Lines.size(); }
+    void inputChar(size_t line, size_t col, wchar_t c) { m_Lines[line].insert(col, 1, c); }
+    void splitLine(size_t line, size_t col) { // enter
+        m_Lines.insert(m_Lines.begin() + line + 1, m_Lines[line].substr(col));
+        m_Lines[line].erase(col);
+    }
+    void joinLine(size_t line) { // backspace at the beginning of line
+        m_Lines[line - 1] += m_Lines[line];
+        m_Lines.erase(m_Lines.begin() + line);
+    }
+    void getScreen(size_t first, std::vector<std::wstring> & out) const {
+        out.clear();
+        for (size_t line = first; line < first + ScreenLines && line < m_Lines.size(); ++line)
+            out.push_back(m_Lines[line]);
+    }
+
+private:
+    std::vector<std::wstring> m_Lines;
+};
+
+/**
+ * Creates text with given number of lines in a temporary file.
+ * @return Name of the file (empty if it could not be created).
+ */
+static std::string createText(size_t lines) {
+    char fileName[] = "/tmp/storageBenchXXXXXX";
+    int fd = mkstemp(fileName);
+    if (fd < 0)
+        return "";
+    close(fd);
+    std::ofstream file(fileName);
+    for (size_t i = 0; i < lines; ++i)
+        file << "2026-10-16 10:" << i % 60 << " meeting log line " << i << ", someone said something important\n";
+    return file ? fileName : "";
+}
+
+/**
+ * @return Microseconds per one call of given operation (it is called count times).
+ */
+static double measure(int count, const std::function<void()> & operation) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+        operation();
+    auto time = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / 1000.0 / count;
+}
+
+static void printRow(const char * layout, size_t lines, double open, double type, double enter, double join,
+                     double screen) {
+    printf("%-12s %8zu %12.1f %12.3f %12.3f %12.3f %12.3f\n", layout, lines, open, type, enter, join, screen);
+}
+
+static bool benchVector(const std::string & fileName, size_t lines) {
+    std::unique_ptr<CLineVector> text;
+    double open = measure(1, [&] {
+        text.reset(new CLineVector());
+        text -> load(fileName);
+    });
+    size_t mid = text -> lineCount() / 2;
+    size_t col = 20;
+    double type = measure(Repeats, [&] { text -> inputChar(mid, col++, L'x'); });
+    double enter = measure(Repeats, [&] { text -> splitLine(mid, 10); });
+    double join = measure(Repeats, [&] { text -> joinLine(mid + 1); });
+    std::vector<std::wstring> screen;
+    double read = measure(Repeats, [&] { text -> getScreen(mid, screen); });
+    printRow("lines", lines, open, type, enter, join, read);
+    return true;
+}
+
+static bool benchBuffer(const char * layout, const std::string & fileName, size_t lines, bool rope) {
+    std::unique_ptr<CTextBuffer> text;
+    bool opened = true;
+    double open = measure(1, [&] {
+        auto file = std::make_shared<CMappedFile>();
+        opened = file -> open(fileName);
+        if (!opened)
+            return;
+        size_t len = file -> size() - 1; // '\n' at the end of file does not create new line
+        text.reset(rope ? (CTextBuffer *) new CRope(file) : new CPieceTable(file));
+        CLoader::TChunk chunk;
+        CLoader::nextChunk(file -> data(), 0, len, len, chunk);
+        text -> appendOriginal(chunk.len, chunk.breaks);
+    });
+    if (!opened)
+        return false;
+    size_t mid = text -> lineCount() / 2;
+    size_t col = 20;
+    double type = measure(Repeats, [&] { text -> insert(text -> lineStart(mid) + col++, "x", 1); });
+    double enter = measure(Repeats, [&] { text -> insert(text -> lineStart(mid) + 10, "\n", 1); });
+    double join = measure(Repeats, [&] { text -> erase(text -> lineStart(mid + 1) - 1, 1); });
+    std::vector<std::string> screen(ScreenLines);
+    double read = measure(Repeats, [&] {
+        for (size_t line = mid; line < mid + ScreenLines && line < text -> lineCount(); ++line)
+            text -> getLine(line, screen[line - mid]);
+    });
+    printRow(layout, lines, open, type, enter, join, read);
+    return true;
+}
+
+/**
+ * Compares editing of text stored as vector of lines (layout of CTextStorage before CTextBuffer) with CPieceTable and
+ * CRope. Every operation is done at the middle of the text, both for a short note and for a long log.
+ */
+int main() {
+    printf("%-12s %8s %12s %12s %12s %12s %12s\n", "layout", "lines", "open [us]", "type [us]", "enter [us]",
+           "join [us]", "screen [us]");
+    bool ok = true;
+    for (size_t lines : {10, 10000, 200000}) {
+        std::string fileName = createText(lines);
+        if (fileName.empty()) {
+            fprintf(stderr, "storageBench: text could not be created\n");
+            return 2;
+        }
+        ok = benchVector(fileName, lines) && ok;
+        ok = benchBuffer("piece table", fileName, lines, false) && ok;
+        ok = benchBuffer("rope", fileName, lines, true) && ok;
+        unlink(fileName.c_str());
+    }
+    return ok ? 0 : 2;
+}
@@ -12,6 +12,11 @@
 #include "CFile.h"
 #include "CConverter.h"
 #include "CInform.h"
+#include "CAtomicFile.h"
+#include "CWindow.h"
+
+#include <cstdio>
+#include <string>
 
 
 CApplication::CApplication() {
@@ -19,14 +24,34 @@ CApplication::CApplication() {
 }
 
 CApplication::~CApplication() {
+    CAtomicFile::syncPending(); // saved files must not be lost after the application ends
     CDisplay::end();
 }
 
 void CApplication::run() {
     CDisplay::init();
+    CWindow::setFrameRate(m_FrameRate);
+    CTextStorage::setHorizontalStep(m_HorizontalStep);
     mainMenu();
 }
 
+bool CApplication::parseArgs(int argc, char * argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sync=always")
+            CAtomicFile::setSyncPolicy(CAtomicFile::ESyncPolicy::ALWAYS);
+        else if (arg == "--sync=batched")
+            CAtomicFile::setSyncPolicy(CAtomicFile::ESyncPolicy::BATCHED);
+        else if (arg == "--sync=never")
+            CAtomicFile::setSyncPolicy(CAtomicFile::ESyncPolicy::NEVER);
+        else {
+            fprintf(stderr, "usage: %s [--sync=always|batched|never]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
 void CApplication::mainMenu() {
     CMenu mainMenu({"New", "Open", "Import", "Export", "Exit"},
                    {"Create new note", "Open existing note", "Import notes from CWD", "Export notes to CWD", ""});
@@ -24,9 +24,20 @@ public:
      */
      void run();
 
+    /**
+     * Applies command line options, must be called before the application is created. The only option is
+     * --sync=always|batched|never, which sets CAtomicFile::ESyncPolicy of saved files (batched by default).
+     * @param[in] argc Number of arguments (including name of the program).
+     * @param[in] argv Arguments.
+     * @return False if an option is not valid (usage has been printed).
+     */
+    static bool parseArgs(int argc, char * argv[]);
+
 private:
     // variables
     CNoteStorage m_Storage;
+    static const unsigned int m_FrameRate = 60; // maximal number of screen updates per second
+    static const unsigned int m_HorizontalStep = 50; // how far editor scrolls horizontally (in percent of it's width)
 
     //functions
     void mainMenu();
@@ -0,0 +1,151 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CAtomicFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::mutex CAtomicFile::m_Mutex;
+CAtomicFile::ESyncPolicy CAtomicFile::m_Policy = CAtomicFile::ESyncPolicy::BATCHED;
+std::vector<std::string> CAtomicFile::m_Pending;
+std::chrono::steady_clock::time_point CAtomicFile::m_LastBatch = std::chrono::steady_clock::now();
+CAtomicFile::TStats CAtomicFile::m_LastStats;
+size_t CAtomicFile::m_Committed = 0;
+
+CAtomicFile::CAtomicFile(const std::string & fileName) : m_Tmp(fileName + ".tmp"), m_Good(true),
+                                                         m_Start(std::chrono::steady_clock::now()),
+                                                         m_Stats{fileName, 0, std::chrono::microseconds(0), false} {
+    m_Fd = ::open(m_Tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (m_Fd == -1) {
+        m_Good = false;
+        return;
+    }
+    struct stat original;
+    if (::stat(fileName.c_str(), &original) == 0) // saving must not change permissions of the file
+        fchmod(m_Fd, original.st_mode & 07777);
+}
+
+CAtomicFile::~CAtomicFile() {
+    if (m_Fd != -1) { // file has not been committed
+        ::close(m_Fd);
+        std::remove(m_Tmp.c_str());
+    }
+}
+
+bool CAtomicFile::good() const {
+    return m_Good;
+}
+
+bool CAtomicFile::write(const char * data, size_t len) {
+    while (m_Good && len > 0) {
+        ssize_t written = ::write(m_Fd, data, len);
+        if (written <= 0) {
+            m_Good = false;
+            break;
+        }
+        data += written;
+        len -= written;
+        m_Stats.bytes += written;
+    }
+    return m_Good;
+}
+
+bool CAtomicFile::commit() {
+    if (!m_Good)
+        return false;
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    bool sync = m_Policy != ESyncPolicy::NEVER;
+    lock.unlock();
+
+    // data are on the disk before the rename, so crash can never replace the file by an empty one
+    bool failed = (sync && fsync(m_Fd) != 0);
+    failed = ::close(m_Fd) != 0 || failed;
+    m_Fd = -1;
+    if (failed || std::rename(m_Tmp.c_str(), m_Stats.fileName.c_str()) != 0) {
+        std::remove(m_Tmp.c_str());
+        m_Good = false;
+        return false;
+    }
+    m_Stats.synced = renamed(m_Stats.fileName);
+    m_Stats.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_Start);
+
+    lock.lock();
+    m_LastStats = m_Stats;
+    ++m_Committed;
+    return true;
+}
+
+const CAtomicFile::TStats & CAtomicFile::stats() const {
+    return m_Stats;
+}
+
+bool CAtomicFile::rename(const std::string & from, const std::string & to) {
+    struct stat original;
+    if (::stat(to.c_str(), &original) == 0) // replaced file keeps it's permissions (as if it has been rewritten)
+        chmod(from.c_str(), original.st_mode & 07777);
+    if (std::rename(from.c_str(), to.c_str()) != 0)
+        return false;
+    renamed(to);
+    return true;
+}
+
+void CAtomicFile::setSyncPolicy(ESyncPolicy policy) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Policy = policy;
+}
+
+void CAtomicFile::syncPending() {
+    std::vector<std::string> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        pending.swap(m_Pending);
+        m_LastBatch = std::chrono::steady_clock::now();
+    }
+    for (const auto & dir : pending)
+        syncDirectory(dir);
+}
+
+size_t CAtomicFile::lastStats(TStats & stats) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    stats = m_LastStats;
+    return m_Committed;
+}
+
+bool CAtomicFile::renamed(const std::string & fileName) {
+    size_t slash = fileName.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : fileName.substr(0, slash + 1);
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    switch (m_Policy) {
+        case ESyncPolicy::ALWAYS:
+            lock.unlock();
+            syncDirectory(dir);
+            return true;
+        case ESyncPolicy::BATCHED:
+            if (std::find(m_Pending.begin(), m_Pending.end(), dir) == m_Pending.end()) // notes share one directory
+                m_Pending.push_back(dir);
+            if (std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - m_LastBatch).count()
+                >= m_BatchInterval) {
+                lock.unlock();
+                syncPending();
+                return true;
+            }
+            return false;
+        case ESyncPolicy::NEVER:
+            return false;
+    }
+    return false;
+}
+
+void CAtomicFile::syncDirectory(const std::string & dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY); // new name of the file is stored in the directory
+    if (fd != -1) {
+        fsync(fd);
+        ::close(fd);
+    }
+}
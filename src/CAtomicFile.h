@@ -0,0 +1,122 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * File, that is replaced atomically. Data are written to a temporary file, which is renamed over the original file by
+ * commit(), so a crash never leaves half-written file behind. Temporary file gets permissions of the original file.
+ * Whether (and when) data and the new name are flushed to the disk is given by global sync policy.
+ */
+class CAtomicFile {
+public:
+    enum class ESyncPolicy {
+        ALWAYS, // data are synced before rename, directory after it (new name is on the disk when commit() returns)
+        BATCHED, // data are synced before rename, directories are synced together, at most once per m_BatchInterval
+                 // (and by syncPending()), crash before that may leave the previous version of the file
+        NEVER // syncing is left to the operating system
+    };
+
+    struct TStats {
+        std::string fileName;
+        size_t bytes; // number of written bytes
+        std::chrono::microseconds time; // time from opening of the file to the end of commit()
+        bool synced; // true if new name of the file has been synced to the disk before commit() returned
+    };
+
+    /**
+     * Creates temporary file, to which data will be written.
+     * @param[in] fileName File, that will be replaced by commit().
+     */
+    explicit CAtomicFile(const std::string & fileName);
+
+    /**
+     * Removes temporary file, if commit() has not been called (or failed).
+     */
+    ~CAtomicFile();
+    CAtomicFile(const CAtomicFile &) = delete;
+    CAtomicFile & operator = (const CAtomicFile &) = delete;
+
+    /**
+     * @return True if temporary file has been created and all writes succeeded.
+     */
+    bool good() const;
+
+    /**
+     * Writes given data to the temporary file (data are not buffered, so they should be given in big parts).
+     * @param[in] data Data to write.
+     * @param[in] len Length of data.
+     * @return True if data have been written.
+     */
+    bool write(const char * data, size_t len);
+
+    /**
+     * Syncs temporary file (unless policy is NEVER) and renames it over the original file.
+     * @return True if file has been replaced.
+     */
+    bool commit();
+
+    /**
+     * @return Statistics of this file (valid after commit()).
+     */
+    const TStats & stats() const;
+
+    /**
+     * Renames file, durability of the new name is given by sync policy (as if it has been written by CAtomicFile), data
+     * of the file should already be synced. If file with the new name exists, renamed file gets it's permissions.
+     * @param[in] from Current name of the file.
+     * @param[in] to New name of the file.
+     * @return True if file has been renamed.
+     */
+    static bool rename(const std::string & from, const std::string & to);
+
+    /**
+     * Changes sync policy of all files.
+     */
+    static void setSyncPolicy(ESyncPolicy policy);
+
+    /**
+     * Syncs directories of all files, that have been committed under BATCHED policy and have not been synced yet.
+     */
+    static void syncPending();
+
+    /**
+     * @param[out] stats Statistics of last committed file.
+     * @return Number of files committed so far (0 means that stats have not been filled).
+     */
+    static size_t lastStats(TStats & stats);
+
+private:
+    static const int m_BatchInterval = 5; // seconds between two syncs of pending directories under BATCHED policy
+
+    std::string m_Tmp; // name of temporary file
+    int m_Fd; // file descriptor of temporary file (-1 if it is not open)
+    bool m_Good;
+    std::chrono::steady_clock::time_point m_Start;
+    TStats m_Stats;
+
+    static std::mutex m_Mutex; // protects static members below (files can be written by more threads)
+    static ESyncPolicy m_Policy;
+    static std::vector<std::string> m_Pending; // directories of committed files, that have not been synced yet
+    static std::chrono::steady_clock::time_point m_LastBatch;
+    static TStats m_LastStats;
+    static size_t m_Committed;
+
+    /**
+     * Called after file has been renamed, syncs it's directory or adds it to pending directories.
+     * @return True if directory has been synced.
+     */
+    static bool renamed(const std::string & fileName);
+
+    /**
+     * Flushes given directory (names of files in it) to the disk.
+     */
+    static void syncDirectory(const std::string & dir);
+};
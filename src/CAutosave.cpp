@@ -0,0 +1,82 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CAutosave.h"
+#include "CAtomicFile.h"
+
+#include <cstdio>
+
+CAutosave::CAutosave(const std::string & fileName) : m_FileName(fileName), m_Thread(&CAutosave::run, this) {}
+
+CAutosave::~CAutosave() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Changed.notify_all();
+    m_Thread.join();
+}
+
+void CAutosave::save(const std::shared_ptr<const CTextBuffer> & snapshot, size_t revision) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Pending = snapshot; // older snapshot, that has not been written yet, is dropped
+        m_PendingRevision = revision;
+    }
+    m_Changed.notify_all();
+}
+
+size_t CAutosave::wait() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Changed.wait(lock, [this] { return !m_Pending && !m_Writing; });
+    return m_Saved;
+}
+
+bool CAutosave::moveTo(const std::string & path, size_t revision) {
+    if (wait() != revision || !CAtomicFile::rename(m_FileName, path))
+        return false;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Saved = m_NoRevision;
+    return true;
+}
+
+void CAutosave::remove() {
+    wait();
+    std::remove(m_FileName.c_str());
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Saved = m_NoRevision;
+}
+
+void CAutosave::run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Changed.wait(lock, [this] { return m_Pending || m_Stop; });
+        if (!m_Pending)
+            return;
+        std::shared_ptr<const CTextBuffer> snapshot = std::move(m_Pending);
+        m_Pending = nullptr;
+        size_t revision = m_PendingRevision;
+        m_Writing = true;
+
+        lock.unlock(); // editor can give new snapshot while this one is being written
+        bool written = write(*snapshot, m_FileName);
+        snapshot = nullptr;
+        lock.lock();
+
+        m_Saved = written ? revision : m_NoRevision;
+        m_Writing = false;
+        m_Changed.notify_all();
+    }
+}
+
+bool CAutosave::write(const CTextBuffer & text, const std::string & fileName) {
+    CAtomicFile file(fileName);
+    std::string part;
+    for (size_t pos = 0; pos < text.size() && file.good(); pos += m_WriteSize) {
+        text.read(pos, text.size() - pos < m_WriteSize ? text.size() - pos : m_WriteSize, part);
+        file.write(part.data(), part.size());
+    }
+    return file.commit();
+}
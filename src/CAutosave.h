@@ -0,0 +1,86 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include "CTextBuffer.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Writes snapshots of text to a file in background thread, so that the editor never waits for the disk. If new snapshot
+ * is given before the previous one has been written, only the newer one is written.
+ */
+class CAutosave {
+public:
+    static const size_t m_NoRevision = (size_t) -1;
+
+    /**
+     * Starts background thread.
+     * @param[in] fileName File to which snapshots will be written.
+     */
+    explicit CAutosave(const std::string & fileName);
+
+    /**
+     * Finishes writing of the last snapshot and stops background thread.
+     */
+    ~CAutosave();
+    CAutosave(const CAutosave &) = delete;
+    CAutosave & operator = (const CAutosave &) = delete;
+
+    /**
+     * Passes snapshot to background thread, which will write it to the file.
+     * @param[in] snapshot Snapshot of text.
+     * @param[in] revision Revision of text in the snapshot.
+     */
+    void save(const std::shared_ptr<const CTextBuffer> & snapshot, size_t revision);
+
+    /**
+     * Waits until all given snapshots are written.
+     * @return Revision of text stored in the file, m_NoRevision if there is no file (or writing failed).
+     */
+    size_t wait();
+
+    /**
+     * If the file contains given revision of text, the file is moved to given path (no text has to be written).
+     * @param[in] path New path of the file.
+     * @param[in] revision Revision of text, that should be saved.
+     * @return True if file has been moved, false otherwise.
+     */
+    bool moveTo(const std::string & path, size_t revision);
+
+    /**
+     * Waits until all given snapshots are written and deletes the file.
+     */
+    void remove();
+
+private:
+    static const size_t m_WriteSize = 1024 * 1024; // text is copied from snapshot to the file by parts of this size
+
+    const std::string m_FileName;
+    std::shared_ptr<const CTextBuffer> m_Pending; // snapshot, that should be written next (nullptr if none)
+    size_t m_PendingRevision = m_NoRevision;
+    size_t m_Saved = m_NoRevision; // revision stored in the file
+    bool m_Writing = false;
+    bool m_Stop = false;
+    std::mutex m_Mutex; // protects all members above
+    std::condition_variable m_Changed; // notified when snapshot is given or written
+    std::thread m_Thread;
+
+    /**
+     * Main function of background thread.
+     */
+    void run();
+
+    /**
+     * Writes given text to given file (using CAtomicFile, so that the file is never half-written).
+     * @return True if text has been written, false otherwise.
+     */
+    static bool write(const CTextBuffer & text, const std::string & fileName);
+};
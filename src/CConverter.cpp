@@ -5,6 +5,7 @@
 
 #include "CConverter.h"
 
+#include <cstdio>
 #include <string>
 
 // declaration
@@ -18,3 +19,89 @@ std::wstring CConverter::toWString(const std::string & string) {
     return Converter.from_bytes(string);
 }
 
+void CConverter::decode(const char * text, size_t len, std::wstring & out) {
+    out.clear();
+    for (size_t i = 0; i < len;) {
+        auto lead = (unsigned char) text[i];
+        size_t seq = sequenceLength(text + i, len - i);
+        wchar_t c;
+        switch (seq) {
+            case 2:
+                c = lead & 0x1F;
+                break;
+            case 3:
+                c = lead & 0x0F;
+                break;
+            case 4:
+                c = lead & 0x07;
+                break;
+            default:
+                c = lead;
+        }
+        for (size_t j = 1; j < seq; ++j)
+            c = (c << 6) | (text[i + j] & 0x3F);
+        out += c;
+        i += seq;
+    }
+}
+
+void CConverter::encode(wchar_t c, std::string & out) {
+    auto code = (unsigned long) c;
+    if (code < 0x80)
+        out += (char) code;
+    else if (code < 0x800) {
+        out += (char) (0xC0 | (code >> 6));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000) {
+        out += (char) (0xE0 | (code >> 12));
+        out += (char) (0x80 | ((code >> 6) & 0x3F));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+    else {
+        out += (char) (0xF0 | (code >> 18));
+        out += (char) (0x80 | ((code >> 12) & 0x3F));
+        out += (char) (0x80 | ((code >> 6) & 0x3F));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+}
+
+size_t CConverter::charOffset(const char * text, size_t len, size_t index) {
+    size_t pos = 0;
+    for (; pos < len && index > 0; --index)
+        pos += sequenceLength(text + pos, len - pos);
+    return pos;
+}
+
+size_t CConverter::sequenceLength(const char * text, size_t left) {
+    auto lead = (unsigned char) text[0];
+    size_t seq;
+    if (lead < 0x80)
+        return 1;
+    else if ((lead & 0xE0) == 0xC0)
+        seq = 2;
+    else if ((lead & 0xF0) == 0xE0)
+        seq = 3;
+    else if ((lead & 0xF8) == 0xF0)
+        seq = 4;
+    else
+        return 1; // lone continuation byte or invalid lead byte
+
+    if (seq > left)
+        return 1;
+    for (size_t i = 1; i < seq; ++i)
+        if ((text[i] & 0xC0) != 0x80) // not a continuation byte
+            return 1;
+    return seq;
+}
+
+std::string CConverter::toReadableSize(size_t bytes) {
+    static const char * units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double size = bytes;
+    unsigned int unit = 0;
+    for (; size >= 1024 && unit < 4; ++unit)
+        size /= 1024;
+    char text[32];
+    snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.1f %s", size, units[unit]);
+    return text;
+}
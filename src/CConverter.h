@@ -33,10 +33,48 @@ public:
      */
     static std::wstring toWString(const std::string & string);
 
+    /**
+     * Decodes given UTF-8 bytes. Unlike toWString, invalid byte sequences do not cause exception, each invalid byte is
+     * decoded as one character of the same value.
+     * @param[in] text Bytes to decode.
+     * @param[in] len Number of bytes.
+     * @param[out] out Decoded text (previous content is replaced).
+     */
+    static void decode(const char * text, size_t len, std::wstring & out);
+
+    /**
+     * Appends UTF-8 representation of given char to given string.
+     * @param[in] c Char to encode.
+     * @param[in, out] out String to which encoded char will be appended.
+     */
+    static void encode(wchar_t c, std::string & out);
+
+    /**
+     * Finds position of given char in UTF-8 bytes (chars are counted the same way as in decode()).
+     * @param[in] text UTF-8 bytes.
+     * @param[in] len Number of bytes.
+     * @param[in] index Index of char.
+     * @return Position of first byte of given char, or len if there are not enough chars.
+     */
+    static size_t charOffset(const char * text, size_t len, size_t index);
+
+    /**
+     * Converts number of bytes to human readable text (for example "1.5 MiB").
+     * @param[in] bytes Number of bytes.
+     * @return Readable size.
+     */
+    static std::string toReadableSize(size_t bytes);
+
     /**
      * Class that handles the conversions.
      */
     static std::wstring_convert<std::codecvt_utf8<wchar_t> , wchar_t> Converter;
+
+private:
+    /**
+     * @return Number of bytes of UTF-8 sequence starting at given position (1 for invalid sequences).
+     */
+    static size_t sequenceLength(const char * text, size_t left);
 };
 
 
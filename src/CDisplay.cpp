@@ -6,6 +6,7 @@
 
 #include "CDisplay.h"
 #include <ncurses.h>
+#include <cstdio>
 
 
 void CDisplay::init() {
@@ -27,6 +28,13 @@ void CDisplay::clear() {
     refresh();
 }
 
+void CDisplay::bracketedPaste(bool enable) {
+    define_key("\033[200~", enable ? EKey::PasteBegin : 0); // 0 removes the definition
+    define_key("\033[201~", enable ? EKey::PasteEnd : 0);
+    putp(enable ? "\033[?2004h" : "\033[?2004l");
+    fflush(stdout);
+}
+
 void CDisplay::setupColorPairs() {
     // white is defined by default
     createPair(ECol::Blue, 0, 599, 999);
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <string>
+#include <ncurses.h>
 
 /**
  * This class is used for initializing and ending Ncurses screen.
@@ -32,6 +33,13 @@ public:
      */
     static void clear();
 
+    /**
+     * Enables or disables bracketed paste mode of the terminal. When it is enabled, pasted text is surrounded by
+     * EKey::PasteBegin and EKey::PasteEnd keys (terminals that do not support it simply send pasted text).
+     * @param[in] enable True to enable, false to disable.
+     */
+    static void bracketedPaste(bool enable);
+
     /**
      * Color pairs (only color of text is changed, background is always black).
      */
@@ -49,6 +57,14 @@ public:
         LightBlue,
         Gray
     };
+
+    /**
+     * Keys defined by the application (ncurses reports them as any other key).
+     */
+    enum EKey {
+        PasteBegin = KEY_MAX + 1,
+        PasteEnd
+    };
 private:
     static void setupColorPairs();
     static void createPair(short col, short R, short G, short B);
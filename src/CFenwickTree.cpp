@@ -0,0 +1,46 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CFenwickTree.h"
+
+void CFenwickTree::assign(const std::vector<size_t> & values) {
+    m_Tree.assign(values.size() + 1, 0);
+    for (size_t i = 1; i <= values.size(); ++i) {
+        m_Tree[i] += values[i - 1];
+        size_t parent = i + (i & -i);
+        if (parent <= values.size())
+            m_Tree[parent] += m_Tree[i];
+    }
+}
+
+void CFenwickTree::add(size_t idx, long long delta) {
+    for (size_t i = idx + 1; i < m_Tree.size(); i += i & -i)
+        m_Tree[i] += (size_t) delta; // unsigned overflow makes negative delta work as well
+}
+
+size_t CFenwickTree::prefix(size_t count) const {
+    size_t sum = 0;
+    for (size_t i = count; i > 0; i -= i & -i)
+        sum += m_Tree[i];
+    return sum;
+}
+
+size_t CFenwickTree::lowerBound(size_t value) const {
+    size_t pos = 0;
+    size_t step = 1;
+    while (step * 2 < m_Tree.size())
+        step *= 2;
+    for (; step > 0; step /= 2) { // finds largest pos, for which prefix(pos) < value
+        if (pos + step < m_Tree.size() && m_Tree[pos + step] < value) {
+            pos += step;
+            value -= m_Tree[pos];
+        }
+    }
+    return pos;
+}
+
+size_t CFenwickTree::size() const {
+    return m_Tree.empty() ? 0 : m_Tree.size() - 1;
+}
@@ -0,0 +1,52 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Fenwick (binary indexed) tree of non-negative numbers. Changing of a value and computing of prefix sums are both
+ * O(log n).
+ */
+class CFenwickTree {
+public:
+    CFenwickTree() = default;
+
+    /**
+     * Replaces content of the tree by given values. O(n).
+     * @param[in] values New values.
+     */
+    void assign(const std::vector<size_t> & values);
+
+    /**
+     * Adds given number to value on given index.
+     * @param[in] idx Index of value.
+     * @param[in] delta Number to add (may be negative, but value must not become negative).
+     */
+    void add(size_t idx, long long delta);
+
+    /**
+     * @param[in] count Number of values that should be summed.
+     * @return Sum of first count values.
+     */
+    size_t prefix(size_t count) const;
+
+    /**
+     * Finds first index, where prefix sum reaches given value.
+     * @param[in] value Searched value.
+     * @return Smallest idx for which prefix(idx + 1) >= value (size() if there is no such index).
+     */
+    size_t lowerBound(size_t value) const;
+
+    /**
+     * @return Number of values stored in the tree.
+     */
+    size_t size() const;
+
+private:
+    std::vector<size_t> m_Tree; // m_Tree[i] is sum of values (i - lowbit(i), i] (indexed from 1, m_Tree[0] is unused)
+};
@@ -5,4 +5,22 @@
 
 #include "CFormat.h"
 
+#include <algorithm>
 
+void CFormat::applySpans(const CTextStorage & storage, CWindow & window, unsigned int y,
+                         const std::vector<TSpan> & spans) {
+    if (!spans.empty() && spans[0].to == m_WholeLine) { // color of the entire row also resets its format
+        window.setLineColor(y, spans[0].color);
+        return;
+    }
+    window.setLineAttr(y, A_NORMAL); // reset format
+
+    size_t start = storage.convertScreenX(y, 0); // with soft wrap, only part of the line is on this row
+    size_t end = start + window.getWidth();
+    for (const auto & span : spans) {
+        size_t from = std::max(span.from, start);
+        size_t to = std::min(span.to, end);
+        if (from < to)
+            window.setRun(y, from - start, to - from, span.attr, span.color);
+    }
+}
@@ -8,6 +8,7 @@
 #include "CWindow.h"
 #include <ncurses.h>
 #include <string>
+#include <vector>
 
 /**
  * This abstract class represents format of text, for example Markdown.
@@ -18,14 +19,35 @@ public:
     virtual ~CFormat() = default;
 
     /**
-     * This function is used to set formatting in the editor window. It needs CTextStorage to determine which format to use
-     * and window to set the format (because more characters can be affected at once). This function DOES NOT change text
-     * displayed in the given window, but will change it's formatting (for example set some characters to be bold, or change
-     * their color). If param storage does not correspond to param editorWin, the behaviour is undefined.
-     * @param[in] storage TextStorage corresponding to given editorWindow.
-     * @param[in, out] ediotorWin Window corresponding to given TextStorage.
+     * Formatting of part of the line. Spans returned by lineSpans() are runs (they do not overlap and each of them is
+     * applied by one call of CWindow::setRun()).
      */
-   virtual void setFormat(const CTextStorage & storage, CWindow & ediotorWin) const = 0;
+    struct TSpan {
+        size_t from; // index of the first char
+        size_t to; // index after the last char (m_WholeLine if color is set to the entire row, including empty space)
+        int attr; // attribute of the chars (as defined by ncurses)
+        short color; // color of the chars (0 = default)
+    };
+    static const size_t m_WholeLine = (size_t) -1;
+
+    /**
+     * Parses given line, formats, whose blocks span more lines, keep state of the parser at the beginning of every line
+     * (see CLineStates). Formatting is computed by CHighlighter in background thread, so this method and lineSpans()
+     * are called only by this thread.
+     * @param[in] text Text of the line.
+     * @param[in] state State at the beginning of the line (0 for the first line).
+     * @return State at the beginning of the next line.
+     */
+    virtual unsigned char nextState(CTextStorage::TLineView text, unsigned char state) const = 0;
+
+    /**
+     * Computes formatting of given line. Formatting depends only on the text of the line and on the state at it's
+     * beginning.
+     * @param[in] text Text of the line.
+     * @param[in] state State at the beginning of the line.
+     * @param[out] spans Runs of the line (previous content is replaced).
+     */
+    virtual void lineSpans(CTextStorage::TLineView text, unsigned char state, std::vector<TSpan> & spans) const = 0;
 
    /**
     * Returns suffix for given format. For example markdown format will return .md *
@@ -39,6 +61,18 @@ public:
     * @return True if given format is dependent of terminal's ability to display colors, False if not.
     */
    virtual bool needsColor() const = 0;
+
+    /**
+     * Applies runs of a line to given row of the editor window (formatting of the rest of the row is reset). This
+     * function DOES NOT change text displayed in the window. If storage does not correspond to window, the behaviour is
+     * undefined.
+     * @param[in] storage TextStorage corresponding to given window.
+     * @param[in, out] window Window, in which the row is formatted.
+     * @param[in] y Row of the window, that shows the line (with soft wrap, only part of the line is on this row).
+     * @param[in] spans Runs of the line.
+     */
+    static void applySpans(const CTextStorage & storage, CWindow & window, unsigned int y,
+                           const std::vector<TSpan> & spans);
 };
 
 
@@ -0,0 +1,151 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CHighlighter.h"
+#include "CConverter.h"
+
+#include <algorithm>
+#include <pthread.h>
+
+CHighlighter::CHighlighter(const CFormat & format) : m_Format(format), m_Thread(&CHighlighter::run, this) {
+#ifdef SCHED_IDLE
+    sched_param param{0};
+    pthread_setschedparam(m_Thread.native_handle(), SCHED_IDLE, &param); // editor thread always runs first
+#endif
+}
+
+CHighlighter::~CHighlighter() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Changed.notify_all();
+    m_Thread.join();
+}
+
+void CHighlighter::request(const std::shared_ptr<const CTextBuffer> & snapshot, size_t revision,
+                           std::vector<CLineStates::TSplice> & splices, size_t first, size_t last) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Pending = snapshot; // older request, that has not been started yet, is dropped (but not it's changes)
+        m_PendingRevision = revision;
+        m_PendingSplices.insert(m_PendingSplices.end(), splices.begin(), splices.end());
+        m_PendingFirst = first;
+        m_PendingLast = last;
+    }
+    splices.clear();
+    m_Changed.notify_all();
+}
+
+bool CHighlighter::update() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_Fresh)
+        return false;
+    std::swap(m_Shown, m_Ready); // lines keep their capacity, so that neither thread allocates memory
+    m_Fresh = false;
+    return true;
+}
+
+bool CHighlighter::pending() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Pending || m_Working || m_Fresh;
+}
+
+const std::vector<CFormat::TSpan> * CHighlighter::spans(size_t line, size_t revision) const {
+    if (m_Shown.revision != revision || line < m_Shown.first || line - m_Shown.first >= m_Shown.count)
+        return nullptr;
+    return &m_Shown.lines[line - m_Shown.first];
+}
+
+void CHighlighter::run() {
+    std::vector<CLineStates::TSplice> splices;
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Changed.wait(lock, [this] { return m_Pending || m_Stop; });
+        if (m_Stop)
+            return;
+        std::shared_ptr<const CTextBuffer> snapshot = std::move(m_Pending);
+        m_Pending = nullptr;
+        size_t revision = m_PendingRevision;
+        size_t first = m_PendingFirst;
+        size_t last = m_PendingLast;
+        splices.swap(m_PendingSplices);
+        m_Working = true;
+
+        lock.unlock(); // editor can give new request while this one is being computed
+        for (const auto & splice : splices) // states are updated even if the request is interrupted
+            m_States.splice(splice.line, splice.erase, splice.insert);
+        splices.clear();
+        format(*snapshot, revision, first, last);
+        snapshot = nullptr;
+        lock.lock();
+
+        m_Working = false;
+    }
+}
+
+void CHighlighter::format(const CTextBuffer & text, size_t revision, size_t first, size_t last) {
+    size_t count = text.lineCount();
+    last = std::min(last, count - 1); // rows below the end of the text are empty
+    first = std::min(first, last);
+    size_t from = first > m_Margin ? first - m_Margin : 0;
+    size_t to = std::min(last + 1 + m_Margin, count);
+    m_Work.revision = revision;
+    m_Work.first = from;
+    m_Work.count = to - from;
+    if (m_Work.lines.size() < m_Work.count)
+        m_Work.lines.resize(m_Work.count);
+
+    auto parse = [this, &text](size_t line, unsigned char state) {
+        return m_Format.nextState(lineText(text, line), state);
+    };
+    size_t changedFrom;
+    size_t changedTo;
+    m_States.update(last, parse, changedFrom, changedTo);
+    for (size_t line = first; line <= last; ++line)
+        formatLine(text, line);
+    publish(revision, first, last + 1);
+
+    // lines closer to the screen are formatted first, so that scrolling by few lines finds them formatted
+    m_States.update(to - 1, parse, changedFrom, changedTo);
+    for (size_t distance = 1; distance <= m_Margin; ++distance) {
+        if (interrupted())
+            return;
+        if (last + distance < to)
+            formatLine(text, last + distance);
+        if (first >= from + distance)
+            formatLine(text, first - distance);
+    }
+    publish(revision, from, to);
+}
+
+void CHighlighter::formatLine(const CTextBuffer & text, size_t line) {
+    m_Format.lineSpans(lineText(text, line), m_States.state(line), m_Work.lines[line - m_Work.first]);
+}
+
+void CHighlighter::publish(size_t revision, size_t from, size_t to) {
+    m_Copy.revision = revision;
+    m_Copy.first = from;
+    m_Copy.count = to - from;
+    if (m_Copy.lines.size() < m_Copy.count)
+        m_Copy.lines.resize(m_Copy.count);
+    for (size_t line = from; line < to; ++line)
+        m_Copy.lines[line - from] = m_Work.lines[line - m_Work.first];
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::swap(m_Ready, m_Copy); // formatting, that has not been taken, is replaced
+    m_Fresh = true;
+}
+
+CTextStorage::TLineView CHighlighter::lineText(const CTextBuffer & text, size_t line) {
+    text.getLine(line, m_Bytes);
+    CConverter::decode(m_Bytes.data(), m_Bytes.size(), m_Text);
+    return CTextStorage::TLineView{m_Text.data(), m_Text.size()};
+}
+
+bool CHighlighter::interrupted() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Pending || m_Stop;
+}
@@ -0,0 +1,138 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include "CFormat.h"
+#include "CLineStates.h"
+#include "CTextBuffer.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Computes formatting of lines in background thread, so that the editor never waits for the format. Formatting is
+ * computed over a snapshot of the text: displayed lines first, then lines above and below them (so that scrolled
+ * screen is usually formatted already). If new request is given before the previous one has been finished, the
+ * previous one is dropped.
+ */
+class CHighlighter {
+public:
+    static const size_t m_NoRevision = (size_t) -1;
+    static const size_t m_Margin = 100; // number of lines above and below the screen, that are formatted in advance
+
+    /**
+     * Starts background thread.
+     * @param[in] format Format of the text, it must exist until the highlighter is destroyed.
+     */
+    explicit CHighlighter(const CFormat & format);
+
+    /**
+     * Stops background thread (even if the last request has not been finished).
+     */
+    ~CHighlighter();
+    CHighlighter(const CHighlighter &) = delete;
+    CHighlighter & operator = (const CHighlighter &) = delete;
+
+    /**
+     * Passes request to background thread.
+     * @param[in] snapshot Snapshot of text.
+     * @param[in] revision Revision of text in the snapshot.
+     * @param[in, out] splices Changes of lines since the previous request (see CTextStorage::takeSplices()), they are
+     * moved out of the vector.
+     * @param[in] first Index of the first displayed line.
+     * @param[in] last Index of the last displayed line.
+     */
+    void request(const std::shared_ptr<const CTextBuffer> & snapshot, size_t revision,
+                 std::vector<CLineStates::TSplice> & splices, size_t first, size_t last);
+
+    /**
+     * Takes formatting computed since the last call, spans() return it from now on.
+     * @return True if new formatting has been taken.
+     */
+    bool update();
+
+    /**
+     * @return True if request has not been finished or if it's formatting has not been taken by update().
+     */
+    bool pending() const;
+
+    /**
+     * @param[in] line Index of line.
+     * @param[in] revision Current revision of text.
+     * @return Runs of given line taken by update(), nullptr if they have not been computed for given revision.
+     */
+    const std::vector<CFormat::TSpan> * spans(size_t line, size_t revision) const;
+
+private:
+    /**
+     * Formatting of consecutive lines.
+     */
+    struct TResult {
+        size_t revision = m_NoRevision;
+        size_t first = 0; // index of the line of lines[0]
+        size_t count = 0; // number of valid lines (lines are not shrunk, so that their capacity is reused)
+        std::vector<std::vector<CFormat::TSpan>> lines;
+    };
+
+    const CFormat & m_Format;
+    std::shared_ptr<const CTextBuffer> m_Pending; // snapshot of the next request (nullptr if none)
+    size_t m_PendingRevision = m_NoRevision;
+    std::vector<CLineStates::TSplice> m_PendingSplices; // changes since the last request, that has been started
+    size_t m_PendingFirst = 0;
+    size_t m_PendingLast = 0;
+    TResult m_Ready; // formatting published by background thread, that has not been taken yet
+    bool m_Fresh = false; // true if m_Ready has not been taken yet
+    bool m_Working = false;
+    bool m_Stop = false;
+    mutable std::mutex m_Mutex; // protects all members above
+    std::condition_variable m_Changed; // notified when request is given or stop is requested
+
+    TResult m_Shown; // formatting taken by update() (used only by the editor thread)
+
+    // used only by background thread
+    CLineStates m_States;
+    TResult m_Work; // formatting of the current request
+    TResult m_Copy; // copy of part of m_Work, that is published next
+    std::string m_Bytes;
+    std::wstring m_Text;
+    std::thread m_Thread;
+
+    /**
+     * Main function of background thread.
+     */
+    void run();
+
+    /**
+     * Computes formatting of displayed lines and publishes it, then does the same for lines around them (unless new
+     * request is given meanwhile).
+     */
+    void format(const CTextBuffer & text, size_t revision, size_t first, size_t last);
+
+    /**
+     * Computes runs of given line to m_Work.
+     */
+    void formatLine(const CTextBuffer & text, size_t line);
+
+    /**
+     * Copies given lines of m_Work to m_Ready (lines are copied before the lock is taken, so that the editor does not
+     * wait for it).
+     */
+    void publish(size_t revision, size_t from, size_t to);
+
+    /**
+     * @return Decoded text of given line (valid until next call).
+     */
+    CTextStorage::TLineView lineText(const CTextBuffer & text, size_t line);
+
+    /**
+     * @return True if background thread should stop computing current request (new request has been given).
+     */
+    bool interrupted() const;
+};
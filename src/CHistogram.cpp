@@ -0,0 +1,77 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CHistogram.h"
+
+#include <cmath>
+#include <iomanip>
+
+CHistogram::CHistogram() : m_Counts((64 - m_SubBits + 1) * m_SubCount, 0), m_Count(0), m_Max(0) {}
+
+void CHistogram::record(uint64_t value) {
+    ++m_Counts[bucket(value)];
+    ++m_Count;
+    if (value > m_Max)
+        m_Max = value;
+}
+
+uint64_t CHistogram::percentile(double percentile) const {
+    if (m_Count == 0)
+        return 0;
+    uint64_t target = (uint64_t) std::ceil(percentile / 100 * m_Count);
+    if (target == 0)
+        target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_Counts.size(); ++i) {
+        seen += m_Counts[i];
+        if (seen >= target) // values in the last bucket can not be bigger than maximum
+            return highestValue(i) < m_Max ? highestValue(i) : m_Max;
+    }
+    return m_Max;
+}
+
+uint64_t CHistogram::count() const {
+    return m_Count;
+}
+
+uint64_t CHistogram::max() const {
+    return m_Max;
+}
+
+void CHistogram::print(std::ostream & out) const {
+    out << std::setw(12) << "Value" << std::setw(15) << "Percentile" << std::setw(11) << "TotalCount"
+        << std::setw(17) << "1/(1-Percentile)" << "\n\n";
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_Counts.size(); ++i) {
+        if (m_Counts[i] == 0)
+            continue;
+        seen += m_Counts[i];
+        double fraction = (double) seen / m_Count;
+        uint64_t value = highestValue(i) < m_Max ? highestValue(i) : m_Max;
+        out << std::fixed << std::setw(12) << std::setprecision(3) << (double) value
+            << std::setw(15) << std::setprecision(12) << fraction << std::setw(11) << seen;
+        if (seen < m_Count)
+            out << std::setw(15) << std::setprecision(2) << 1 / (1 - fraction);
+        out << '\n';
+    }
+    out << "#[Max     = " << m_Max << ", Total count    = " << m_Count << "]\n";
+}
+
+size_t CHistogram::bucket(uint64_t value) {
+    if (value < 2 * m_SubCount) // small values are stored exactly
+        return value;
+    int shift = 0; // how many low bits are ignored (value >> shift has m_SubBits + 1 bits)
+    while ((value >> shift) >= 2 * m_SubCount)
+        ++shift;
+    return shift * m_SubCount + (value >> shift);
+}
+
+uint64_t CHistogram::highestValue(size_t bucket) {
+    if (bucket < 2 * m_SubCount)
+        return bucket;
+    size_t shift = bucket / m_SubCount - 1;
+    uint64_t sub = bucket - shift * m_SubCount;
+    return ((sub + 1) << shift) - 1;
+}
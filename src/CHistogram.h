@@ -0,0 +1,69 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * Histogram of non-negative values (for example latencies in microseconds) with bounded relative error (HDR histogram).
+ * Values up to 2 * m_SubCount are stored exactly, bigger values share bucket with values that differ in less than
+ * 1 / m_SubCount of their size. Recording is O(1) and memory does not depend on number of values.
+ */
+class CHistogram {
+public:
+    CHistogram();
+    ~CHistogram() = default;
+    CHistogram(const CHistogram &) = delete;
+    CHistogram & operator = (const CHistogram &) = delete;
+
+    /**
+     * Records given value.
+     * @param[in] value Value to record.
+     */
+    void record(uint64_t value);
+
+    /**
+     * @param[in] percentile Percentile (0 - 100).
+     * @return Value, that is bigger or equal to given percent of recorded values (0 if nothing has been recorded).
+     */
+    uint64_t percentile(double percentile) const;
+
+    /**
+     * @return Number of recorded values.
+     */
+    uint64_t count() const;
+
+    /**
+     * @return Biggest recorded value.
+     */
+    uint64_t max() const;
+
+    /**
+     * Prints percentile distribution of recorded values (in the format used by HdrHistogram, one line per bucket).
+     * @param[in,out] out Stream to which distribution is printed.
+     */
+    void print(std::ostream & out) const;
+
+private:
+    static const int m_SubBits = 5;
+    static const uint64_t m_SubCount = 1 << m_SubBits; // number of buckets per power of two (relative error < 3.2 %)
+
+    std::vector<uint64_t> m_Counts; // number of values in every bucket
+    uint64_t m_Count;
+    uint64_t m_Max;
+
+    /**
+     * @return Index of bucket, to which given value belongs.
+     */
+    static size_t bucket(uint64_t value);
+
+    /**
+     * @return Biggest value, that belongs to given bucket.
+     */
+    static uint64_t highestValue(size_t bucket);
+};
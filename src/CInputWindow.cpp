@@ -30,14 +30,16 @@ std::wstring CInputWindow::run() {
 }
 
 std::wstring CInputWindow::userInput() {
-    auto input = readWch();
-    while (input != KEY_ENTER && input != '\r' && input != '\n') {
-        if (m_FileName && ((input >= L'A' && input <= L'Z') || (input >= L'a' && input <= L'z')
+    wint_t input;
+    bool key;
+    tryReadWch(input, -1, key);
+    while (!(key && input == KEY_ENTER) && input != '\r' && input != '\n') {
+        if (m_FileName && !key && ((input >= L'A' && input <= L'Z') || (input >= L'a' && input <= L'z')
                             || (input >= L'0' && input <= L'9') || input == L'_')) {
             inputKeyAction(input);
         }
         else {
-            switch (input) {
+            switch (key || input < KEY_MIN ? input : WEOF) { // chars with codes of function keys are typed
                 case KEY_RIGHT:
                     rightKeyAction();
                     break;
@@ -54,11 +56,11 @@ std::wstring CInputWindow::userInput() {
                 case '|':
                     break;
                 default:
-                    if (!m_FileName && CUnsupportedInput::isSupported(input))
+                    if (!m_FileName && !key && CUnsupportedInput::isSupported(input))
                         inputKeyAction(input);
             }
         }
-        input = readWch();
+        tryReadWch(input, -1, key);
         refreshWindow();
     }
     return m_UserInput;
@@ -0,0 +1,35 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CLineStates.h"
+
+#include <algorithm>
+
+CLineStates::CLineStates() : m_Valid(0), m_Edited(0) {}
+
+void CLineStates::clear() {
+    std::vector<unsigned char>().swap(m_States);
+    m_Valid = 0;
+    m_Edited = 0;
+}
+
+void CLineStates::splice(size_t line, size_t erase, size_t insert) {
+    if (line >= m_States.size()) // these lines have not been parsed yet
+        return;
+    // state at the beginning of the changed line does not depend on it, states of new lines are outdated copies
+    size_t first = line + 1;
+    size_t end = std::max(first, line + std::min(erase, m_States.size() - line));
+    m_States.erase(m_States.begin() + first, m_States.begin() + end);
+    m_States.insert(m_States.begin() + first, insert - 1, m_States[line]);
+
+    m_Valid = std::min(m_Valid, first);
+    if (m_Edited >= line && m_Edited - line >= erase) // previous change below these lines has moved
+        m_Edited = m_Edited - erase + insert;
+    m_Edited = std::max(m_Edited, line + insert);
+}
+
+unsigned char CLineStates::state(size_t line) const {
+    return m_States[line];
+}
@@ -0,0 +1,95 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * States of a line by line parser (for example of highlighting of a format) at the beginning of every line, state of
+ * the first line is always 0. Lines are parsed lazily, only up to the last line, whose state is needed. After a change
+ * of text, states of lines below it are not removed, they are only outdated. Parsing starts at the changed line and it
+ * stops, when it gets behind all changed lines to a line, whose state has not changed (states of the rest of lines
+ * are valid again). If it reaches the last needed line first, states below it are removed. So change, that does not
+ * affect following lines, is parsed in O(1) lines, opening of a block is parsed only up to the last needed line.
+ */
+class CLineStates {
+public:
+    /**
+     * Change of lines, arguments of splice().
+     */
+    struct TSplice {
+        size_t line;
+        size_t erase;
+        size_t insert;
+    };
+    static const size_t m_AllLines = (size_t) -1; // erase count, that removes all lines below the changed line
+
+    CLineStates();
+
+    /**
+     * Removes all states (for example when other text is loaded).
+     */
+    void clear();
+
+    /**
+     * Updates states after change of text: given lines have been replaced by given number of new lines.
+     * @param[in] line Index of first changed line (state at it's beginning stays valid).
+     * @param[in] erase Number of lines, that contained changed text.
+     * @param[in] insert Number of lines, that contain changed text now.
+     */
+    void splice(size_t line, size_t erase, size_t insert);
+
+    /**
+     * Parses lines, that are needed to know state of given line.
+     * @param[in] last Index of the last line, whose state is needed.
+     * @param[in] parse Callable unsigned char (size_t line, unsigned char state), that parses given line starting in
+     * given state and returns state at the beginning of the next line.
+     * @param[out] from First line, whose stored state has changed.
+     * @param[out] to Line after the last line, whose stored state has changed.
+     * @return False if no stored state has changed (lines parsed for the first time are not counted).
+     */
+    template <typename TParser>
+    bool update(size_t last, TParser parse, size_t & from, size_t & to) {
+        bool changed = false;
+        if (m_States.empty()) {
+            m_States.push_back(0);
+            m_Valid = 1;
+        }
+        while (m_Valid <= last) {
+            unsigned char next = parse(m_Valid - 1, m_States[m_Valid - 1]);
+            if (m_Valid == m_States.size())
+                m_States.push_back(next);
+            else if (m_States[m_Valid] == next && m_Valid >= m_Edited) { // parsing has caught up with stored states
+                m_Valid = m_States.size();
+                m_Edited = 0;
+                continue;
+            }
+            else if (m_States[m_Valid] != next) {
+                if (!changed)
+                    from = m_Valid;
+                changed = true;
+                to = m_Valid + 1;
+                m_States[m_Valid] = next;
+            }
+            ++m_Valid;
+        }
+        if (m_Valid < m_States.size() && m_Edited) // parsing has not caught up, stored states below are not valid
+            m_States.resize(m_Valid);
+        return changed;
+    }
+
+    /**
+     * @param[in] line Index of line, that has been passed to update().
+     * @return State at the beginning of given line.
+     */
+    unsigned char state(size_t line) const;
+
+private:
+    std::vector<unsigned char> m_States; // state at the beginning of every line, that has been parsed
+    size_t m_Valid; // states of lines [0, m_Valid) are valid, states of other lines may be outdated
+    size_t m_Edited; // line after the last changed line (parsing can not stop before it), 0 if nothing has changed
+};
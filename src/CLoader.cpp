@@ -0,0 +1,66 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CLoader.h"
+
+#include <cstring>
+
+CLoader::CLoader(const std::shared_ptr<const CMappedFile> & file, size_t begin, size_t end)
+                : m_File(file), m_Begin(begin), m_End(end), m_Thread(&CLoader::run, this) {}
+
+CLoader::~CLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Thread.join();
+}
+
+bool CLoader::take(TChunk & chunk, bool wait) {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    if (wait)
+        m_ChunkReady.wait(lock, [this] { return !m_Chunks.empty() || m_Done; });
+    if (m_Chunks.empty())
+        return false;
+    chunk = std::move(m_Chunks.front());
+    m_Chunks.pop_front();
+    return true;
+}
+
+bool CLoader::finished() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Done && m_Chunks.empty();
+}
+
+void CLoader::nextChunk(const char * data, size_t begin, size_t end, size_t maxLen, TChunk & chunk) {
+    chunk.start = begin;
+    chunk.breaks.clear();
+    const char * it = data + begin;
+    const char * limit = data + (end - begin > maxLen ? begin + maxLen : end);
+    while ((it = (const char *) memchr(it, '\n', data + end - it))) {
+        chunk.breaks.push_back(it - data);
+        if (++it >= limit) // chunk always ends after '\n', so that it does not end in the middle of a line
+            break;
+    }
+    chunk.len = (it ? it - data : end) - begin;
+}
+
+void CLoader::run() {
+    size_t pos = m_Begin;
+    while (pos < m_End) {
+        TChunk chunk;
+        nextChunk(m_File -> data(), pos, m_End, m_ChunkSize, chunk);
+        pos += chunk.len;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Stop)
+            return;
+        m_Chunks.push_back(std::move(chunk));
+        m_ChunkReady.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Done = true;
+    m_ChunkReady.notify_all();
+}
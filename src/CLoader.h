@@ -0,0 +1,85 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include "CMappedFile.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Indexes memory mapped file in background thread. File is split into chunks (every chunk ends with '\n' or at the end
+ * of the file), for every chunk positions of all '\n' are found. Finished chunks can be taken one by one (in order in
+ * which they are in the file) and appended to CTextBuffer.
+ */
+class CLoader {
+public:
+    struct TChunk {
+        size_t start; // position of chunk in the file
+        size_t len;
+        std::vector<size_t> breaks; // positions of all '\n' in the chunk (counted from the beginning of the file)
+    };
+
+    /**
+     * Starts indexing of given part of given file in background thread.
+     * @param[in] file File to index.
+     * @param[in] begin Position where indexing should start.
+     * @param[in] end Position where indexing should end.
+     */
+    CLoader(const std::shared_ptr<const CMappedFile> & file, size_t begin, size_t end);
+
+    /**
+     * Stops the background thread (even if file has not been indexed yet).
+     */
+    ~CLoader();
+    CLoader(const CLoader &) = delete;
+    CLoader & operator = (const CLoader &) = delete;
+
+    /**
+     * Takes next indexed chunk.
+     * @param[out] chunk Taken chunk.
+     * @param[in] wait If true and next chunk is not ready yet, this method waits for it.
+     * @return True if chunk was taken, false if no chunk is ready (or all chunks have already been taken).
+     */
+    bool take(TChunk & chunk, bool wait);
+
+    /**
+     * @return True if all chunks have been taken.
+     */
+    bool finished();
+
+    /**
+     * Indexes one chunk starting at given position. Chunk ends with the first '\n' after maxLen bytes or at end.
+     * @param[in] data Data of the file.
+     * @param[in] begin Position where chunk starts.
+     * @param[in] end Position where file (or it's indexed part) ends.
+     * @param[in] maxLen Preferred size of chunk.
+     * @param[out] chunk Indexed chunk.
+     */
+    static void nextChunk(const char * data, size_t begin, size_t end, size_t maxLen, TChunk & chunk);
+
+private:
+    static const size_t m_ChunkSize = 1024 * 1024;
+
+    std::shared_ptr<const CMappedFile> m_File;
+    size_t m_Begin;
+    size_t m_End;
+    std::deque<TChunk> m_Chunks; // indexed chunks, that have not been taken yet
+    bool m_Done = false; // true when background thread has indexed everything
+    bool m_Stop = false; // tells background thread to stop
+    std::mutex m_Mutex; // protects m_Chunks, m_Done and m_Stop
+    std::condition_variable m_ChunkReady; // notified after every indexed chunk
+    std::thread m_Thread;
+
+    /**
+     * Main function of background thread.
+     */
+    void run();
+};
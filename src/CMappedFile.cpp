@@ -0,0 +1,55 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CMappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CMappedFile::~CMappedFile() {
+    close();
+}
+
+bool CMappedFile::open(const std::string & fileName) {
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    close();
+    if (info.st_size > 0) { // empty file can not be mapped
+        void * mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        m_Data = (const char *) mapped;
+        m_Size = info.st_size;
+    }
+    ::close(fd); // mapping stays valid even after file descriptor is closed
+    return true;
+}
+
+const char * CMappedFile::data() const {
+    return m_Size ? m_Data : "";
+}
+
+size_t CMappedFile::size() const {
+    return m_Size;
+}
+
+void CMappedFile::close() {
+    if (m_Size)
+        munmap((void *) m_Data, m_Size);
+    m_Data = nullptr;
+    m_Size = 0;
+}
@@ -0,0 +1,44 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <string>
+
+/**
+ * Read-only memory mapping of a file. Content is not read when file is opened, pages are loaded by the system when
+ * they are accessed for the first time. Mapped file must not be truncated while it is mapped (files should be replaced
+ * by renaming a new file instead of rewriting them).
+ */
+class CMappedFile {
+public:
+    CMappedFile() = default;
+    ~CMappedFile();
+    CMappedFile(const CMappedFile &) = delete;
+    CMappedFile & operator = (const CMappedFile &) = delete;
+
+    /**
+     * Maps given file to memory.
+     * @param[in] fileName Name of file that should be mapped.
+     * @return True if file was mapped, false otherwise (for example when file does not exist).
+     */
+    bool open(const std::string & fileName);
+
+    /**
+     * @return Pointer to the beginning of mapped file.
+     */
+    const char * data() const;
+
+    /**
+     * @return Size of mapped file in bytes.
+     */
+    size_t size() const;
+
+private:
+    const char * m_Data = nullptr;
+    size_t m_Size = 0;
+
+    void close();
+};
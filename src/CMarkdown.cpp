@@ -8,55 +8,160 @@
 #include "CTextStorage.h"
 #include "CDisplay.h"
 
-void CMarkdown::setFormat(const CTextStorage & storage, CWindow & window) const {
-    if (!has_colors() || !can_change_color()) // terminal does not needed support colors, formatting is turned off.
+#include <algorithm>
+
+std::string CMarkdown::getFileExt() const {
+    return ".md";
+}
+
+void CMarkdown::lineSpans(CTextStorage::TLineView text, unsigned char state, std::vector<TSpan> & spans) const {
+    if (m_Cache.empty())
+        m_Cache.resize(m_CacheSize);
+    uint64_t hash = hashLine(text, state);
+    TCacheEntry & entry = m_Cache[hash % m_CacheSize];
+    if (entry.valid && entry.hash == hash && entry.len == text.len && entry.state == state) {
+        spans = entry.spans;
         return;
+    }
+
+    entry.hash = hash;
+    entry.len = text.len;
+    entry.state = state;
+    entry.valid = true;
+    entry.spans.clear(); // capacity is kept, so that cache does not allocate memory once it is filled
+    if (state == backticks || state == tildes || fence(text) != plain) // code is not formatted, fences are part of it
+        entry.spans.emplace_back(TSpan{0, m_WholeLine, A_NORMAL, CDisplay::Blue});
+    else if (!comments(text, state == comment, &entry.spans)) {
+        if (!specialFormat(text, entry.spans)) // returns true when first set of chars determine line's formatting
+            boldItalic(text, entry.spans, m_Dividers); // finds bold and italic formatting on given line
+    }
+    toRuns(entry.spans, m_Bounds);
+    spans = entry.spans;
+}
 
-    unsigned int winH = window.getHeight();
-    for (unsigned int line = 0; line < winH; line++) {
-        window.setLineColor(line, CDisplay::White); // reset format
-        window.setLineAttr(line, A_NORMAL); // reset format
-        if (!specialFormat(storage, window, line)) { // returns true when first set of chars determine line's formatting
-            boldItalic(storage, window, line); // sets bold and italic formatting on given line
+unsigned char CMarkdown::nextState(CTextStorage::TLineView text, unsigned char state) const {
+    if (state == backticks || state == tildes) // code block ends by the same fence
+        return fence(text) == state ? plain : state;
+    if (state == plain && fence(text) != plain)
+        return fence(text);
+    return comments(text, state == comment, nullptr) ? comment : plain;
+}
+
+unsigned char CMarkdown::fence(CTextStorage::TLineView text) {
+    if (text.len < 3 || text.text[1] != text.text[0] || text.text[2] != text.text[0])
+        return plain;
+    if (text.text[0] == L'`')
+        return backticks;
+    return text.text[0] == L'~' ? tildes : plain;
+}
+
+bool CMarkdown::comments(CTextStorage::TLineView text, bool inside, std::vector<TSpan> * spans) {
+    static const wchar_t open[] = L"<!--";
+    static const wchar_t close[] = L"-->";
+    const wchar_t * end = text.text + text.len;
+    const wchar_t * pos = text.text;
+    while (true) {
+        const wchar_t * start = pos;
+        if (!inside) {
+            start = std::search(pos, end, open, open + 4);
+            if (start == end)
+                return false;
         }
+        pos = std::search(start + (inside ? 0 : 4), end, close, close + 3);
+        bool closed = pos != end;
+        pos = closed ? pos + 3 : end;
+        if (spans)
+            spans -> emplace_back(TSpan{(size_t) (start - text.text), (size_t) (pos - text.text), A_NORMAL,
+                                        CDisplay::Gray});
+        if (!closed)
+            return true;
+        inside = false;
     }
 }
 
-std::string CMarkdown::getFileExt() const {
-    return ".md";
+void CMarkdown::toRuns(std::vector<TSpan> & spans, std::vector<TBound> & bounds) {
+    if (spans.size() < 2)
+        return;
+    bounds.clear();
+    for (const auto & span : spans) {
+        bounds.emplace_back(TBound{span.from, span.attr, span.color, true});
+        bounds.emplace_back(TBound{span.to, span.attr, span.color, false});
+    }
+    std::sort(bounds.begin(), bounds.end(), [](const TBound & a, const TBound & b) { return a.idx < b.idx; });
+
+    // spans, that cover current position (attributes of the parser are only bold and italic)
+    int bold = 0;
+    int italic = 0;
+    int colored = 0;
+    short color = 0;
+    spans.clear();
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        int change = bounds[i].open ? 1 : -1;
+        if (bounds[i].attr & A_BOLD)
+            bold += change;
+        if (bounds[i].attr & A_ITALIC)
+            italic += change;
+        if (bounds[i].color) {
+            colored += change;
+            color = bounds[i].color;
+        }
+        if (i + 1 == bounds.size() || bounds[i + 1].idx == bounds[i].idx || (!bold && !italic && !colored))
+            continue; // run ends here
+        int attr = (int) ((bold ? A_BOLD : A_NORMAL) | (italic ? A_ITALIC : A_NORMAL));
+        TSpan run{bounds[i].idx, bounds[i + 1].idx, attr, (short) (colored ? color : 0)};
+        if (!spans.empty() && spans.back().to == run.from && spans.back().attr == run.attr
+            && spans.back().color == run.color)
+            spans.back().to = run.to; // joins with the previous run
+        else
+            spans.push_back(run);
+    }
+}
+
+uint64_t CMarkdown::hashLine(CTextStorage::TLineView text, unsigned char state) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < text.len; ++i) {
+        hash ^= (uint64_t) text.text[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= state;
+    return hash * 1099511628211ULL;
+}
+
+wchar_t CMarkdown::charAt(CTextStorage::TLineView text, size_t idx) {
+    return idx < text.len ? text.text[idx] : L'\0';
 }
 
-bool CMarkdown::specialFormat(const CTextStorage & storage, CWindow & window, unsigned int line) {
+bool CMarkdown::specialFormat(CTextStorage::TLineView text, std::vector<TSpan> & spans) {
     // returns true when first few chars determines given line formatting (so that check for bold/italic text on given
     //line can be avoided.
 
-    wchar_t first = storage.getChar(line, 0, true);
-    wchar_t second = storage.getChar(line, 1, true);
+    wchar_t first = charAt(text, 0);
+    wchar_t second = charAt(text, 1);
 
     if ((first == L'*' || first == L'-') && second == L' ') { // Bullet Points
-        return bulletList(storage, window, line);
+        return bulletList(text, spans);
     }
     if (first == L'#') { // Headings
-        return heading(storage, window, line);
+        return heading(text, spans);
     }
     if (first == L'>' && second == L' ') { // Quotes
-        return quote(storage, window, line);
+        return quote(text, spans);
     }
     if (first >= L'0' && first <= L'9') { // Numbered lists
-        return numList(storage, window, line);
+        return numList(text, spans);
     }
 
     if (first == L'*' || first == L'_')
-        return lineSep(storage, window, line);
+        return lineSep(text, spans);
 
     return false;
 }
 
-bool CMarkdown::heading(const CTextStorage & storage, CWindow & window, unsigned int line) {
+bool CMarkdown::heading(CTextStorage::TLineView text, std::vector<TSpan> & spans) {
     int level = 0;
     int column = 1;
     while (true) {
-        wchar_t ch = storage.getChar(line, column++, true);
+        wchar_t ch = charAt(text, column++);
         if (level > 5) {
             break;
         }
@@ -65,7 +170,7 @@ bool CMarkdown::heading(const CTextStorage & storage, CWindow & window, unsigned
             continue;
         }
         if (ch == L' ') {
-            window.setLineColor(line, CDisplay::Orangered + level);
+            spans.emplace_back(TSpan{0, m_WholeLine, A_NORMAL, (short) (CDisplay::Orangered + level)});
             return true;
         }
         break;
@@ -73,67 +178,58 @@ bool CMarkdown::heading(const CTextStorage & storage, CWindow & window, unsigned
     return false;
 }
 
-bool CMarkdown::numList(const CTextStorage & storage, CWindow & window, unsigned int line) {
+bool CMarkdown::numList(CTextStorage::TLineView text, std::vector<TSpan> & spans) {
     int column = 1;
     while (true) {
-        wchar_t ch = storage.getChar(line, column++, true);
+        wchar_t ch = charAt(text, column++);
         if (ch >= L'0' && ch <= L'9') {
             continue;
         }
         if (ch == L'.') {
-            ch = storage.getChar(line, column, true);
+            ch = charAt(text, column);
             if (ch == L' ')
-                for (int i = 0; i <= column; ++i) {
-                    if (storage.isOnScreen(storage.convertScreenY(line), i))
-                        window.setColor(line, storage.convertGlobalX(i), CDisplay::LightBlue);
-                }
+                spans.emplace_back(TSpan{0, (size_t) column + 1, A_NORMAL, CDisplay::LightBlue});
         }
         break;
     }
     return false;
 }
 
-bool CMarkdown::quote(const CTextStorage & storage, CWindow & window, unsigned int line) {
-    if (!storage.canScrollLeft()) {
-        window.setColor(line, 0, CDisplay::Purple);
-    }
+bool CMarkdown::quote(CTextStorage::TLineView, std::vector<TSpan> & spans) {
+    spans.emplace_back(TSpan{0, 1, A_NORMAL, CDisplay::Purple});
     return false;
 }
 
-bool CMarkdown::bulletList(const CTextStorage & storage, CWindow & window, unsigned int line) {
-    if (!storage.canScrollLeft()) {
-        window.setColor(line, 0, CDisplay::Green);
-    }
+bool CMarkdown::bulletList(CTextStorage::TLineView, std::vector<TSpan> & spans) {
+    spans.emplace_back(TSpan{0, 1, A_NORMAL, CDisplay::Green});
     return false;
 }
 
-void CMarkdown::boldItalic(const CTextStorage & storage, CWindow & window, unsigned int line) {
-    const std::wstring & text = storage.getLine(line);
-    if (text.size() < 3) // no need to do anything (no formatting will be applied)
+void CMarkdown::boldItalic(CTextStorage::TLineView text, std::vector<TSpan> & spans, std::vector<TDivider> & divs) {
+    if (text.len < 3) // no need to do anything (no formatting will be applied)
         return;
-    std::vector<TDivider> divs;
-    fillDividers(divs, text);
+    divs.clear();
+    fillDividers(divs, text.text, text.len);
 
+    size_t next[4] = {0, 0, 0, 0}; // for each kind of divider ('*' or '_', 1 or 2 of them) where search continues
     for (size_t i = 0; i < divs.size(); ++i) { // loop through dividers
-        if (divs[i].type == EType::end)
+        if (divs[i].type == EType::end || divs[i].used)
             continue;
-        for (size_t j = i + 1; j < divs.size(); ++j) { // find matching divider
-            if (divMatch(divs[i], divs[j])) {
-                applyBoldItalic(divs[i].idx, divs[j].idx + divs[j].cnt, divs[i].cnt, storage, window, line);
-                divs.erase(divs.begin() + j);
-                divs.erase(divs.begin() + i);
-                i = -1;
-                break;
-            }
-        }
+        size_t & j = next[(divs[i].div == L'_' ? 2 : 0) + divs[i].cnt - 1];
+        j = std::max(j, i + 1); // dividers before i can not end any block, that has not been matched yet
+        while (j < divs.size() && (divs[j].used || !divMatch(divs[i], divs[j]))) // find matching divider
+            ++j;
+        if (j == divs.size())
+            continue;
+        spans.emplace_back(TSpan{divs[i].idx, divs[j].idx + divs[j].cnt, getFormat(divs[i].cnt), 0});
+        divs[j].used = true;
     }
 }
 
-void CMarkdown::fillDividers(std::vector<TDivider> & dividers, const std::wstring & text) {
+void CMarkdown::fillDividers(std::vector<TDivider> & dividers, const wchar_t * text, size_t max) {
     const wchar_t d1 = L'*';
     const wchar_t d2 = L'_';
     const wchar_t space = L' ';
-    auto max = text.size();
     bool lastIsEnd = true;
 
     size_t start = 1;
@@ -143,11 +239,11 @@ void CMarkdown::fillDividers(std::vector<TDivider> & dividers, const std::wstrin
         if(text[0] == text[1]) { // first two characters are dividers
             start = 2;
             if ((text[2] != space || max <= 3)) {
-                dividers.emplace_back(TDivider{text[0], 2, 0, curT});
+                dividers.emplace_back(TDivider{text[0], 2, 0, curT, false});
             }
         }
         else if (text[1] != space) // only first one is divider
-            dividers.emplace_back(TDivider{text[0], 1, 0, curT});
+            dividers.emplace_back(TDivider{text[0], 1, 0, curT, false});
     }
 
     for (size_t i = start; i < max - 2; ++i) { // find all dividers and store their position
@@ -161,13 +257,13 @@ void CMarkdown::fillDividers(std::vector<TDivider> & dividers, const std::wstrin
                 if (text[i + 2] != space) {
                     changeType(curT, false); // divider can also be mid/beg
                 }
-                dividers.emplace_back(TDivider{text[i], 2, i++, curT});
+                dividers.emplace_back(TDivider{text[i], 2, i++, curT, false});
             }
             else {
                 changeType(curT, text[i + 1] == space); // if next char is space, type will be increased (can
                                                                   // can be mid/end, if it is false it will be decreased
                                                                   // (can be beg/mid)
-                dividers.emplace_back(TDivider{text[i], 1, i, curT});
+                dividers.emplace_back(TDivider{text[i], 1, i, curT, false});
             }
         }
     }
@@ -176,32 +272,23 @@ void CMarkdown::fillDividers(std::vector<TDivider> & dividers, const std::wstrin
     if (!lastIsEnd) {
         if ((text[max - 2] == d1 || text[max - 2] == d2) && text[max - 3] != space) { // test for the last 2 chars
             if (text[max - 2] == text[max - 1])
-                dividers.emplace_back(TDivider{text[max - 2], 2, max - 2, curT}); // both are dividers
+                dividers.emplace_back(TDivider{text[max - 2], 2, max - 2, curT, false}); // both are dividers
             else
-                dividers.emplace_back(TDivider{text[max - 2], 1, max - 2, curT}); // penultimate is divider
+                dividers.emplace_back(TDivider{text[max - 2], 1, max - 2, curT, false}); // penultimate is divider
         }
         else if ((text[max - 1] == d1 || text[max - 1] == d2) && text[max - 2] != space)
-            dividers.emplace_back(TDivider{text[max - 1], 1, max - 1, curT}); // last is divider
+            dividers.emplace_back(TDivider{text[max - 1], 1, max - 1, curT, false}); // last is divider
     }
     else if ((text[max - 1] == d1 || text[max - 1] == d2) && text[max - 2] != space)
-        dividers.emplace_back(TDivider{text[max - 1], 1, max - 1, curT}); // last is divider
+        dividers.emplace_back(TDivider{text[max - 1], 1, max - 1, curT, false}); // last is divider
     else if ((text[max - 2] == d1 || text[max - 2] == d2) && text[max - 3] != space)
-        dividers.emplace_back(TDivider{text[max - 2], 1, max - 2, curT}); // last is divider
+        dividers.emplace_back(TDivider{text[max - 2], 1, max - 2, curT, false}); // last is divider
 }
 
 bool CMarkdown::divMatch(CMarkdown::TDivider & a, CMarkdown::TDivider & b) {
    return b.type != EType::beg && a.div == b.div && a.cnt == b.cnt;
 }
 
-void CMarkdown::applyBoldItalic(size_t b, size_t e, int count, const CTextStorage & storage, CWindow & window,
-                                unsigned int line) {
-    auto attr = getFormat(count);
-    for (size_t i = b; i < e; ++i) {
-        if (storage.isOnScreen(storage.convertScreenY(line), i))
-            window.addAtr(line, storage.convertGlobalX(i), attr);
-    }
-}
-
 int CMarkdown::getFormat(int count) {
     switch (count) {
         case(1):
@@ -232,18 +319,18 @@ void CMarkdown::changeType(EType & type, bool increase) {
     }
 }
 
-bool CMarkdown::lineSep(const CTextStorage & storage, CWindow & window, unsigned int line) {
+bool CMarkdown::lineSep(CTextStorage::TLineView text, std::vector<TSpan> & spans) {
     int x = 0;
     int count = 1;
-    wchar_t first = storage.getChar(line, x++, false);
+    wchar_t first = charAt(text, x++);
     wchar_t next;
-    while ((next = storage.getChar(line, x++, false))) {
+    while ((next = charAt(text, x++))) {
         count++;
         if (next != first)
             return false;
     }
     if (count > 2) {
-        window.setLineColor(line, CDisplay::Gray);
+        spans.emplace_back(TSpan{0, m_WholeLine, A_NORMAL, CDisplay::Gray});
         return true;
     }
     return false;
@@ -7,6 +7,9 @@
 #include "CFormat.h"
 #include "CTextStorage.h"
 
+#include <cstdint>
+#include <vector>
+
 /**
  * Markdown CFormat.
  */
@@ -17,7 +20,13 @@ public:
     CMarkdown(const CMarkdown &) =  delete;
     CMarkdown & operator = (const CMarkdown &) = delete;
 
-    void setFormat(const CTextStorage & storage, CWindow & window) const override;
+    unsigned char nextState(CTextStorage::TLineView text, unsigned char state) const override;
+
+    /**
+     * Spans are computed only if the line is not in m_Cache. Lines, that have not changed (or that have been changed
+     * back by undo), are not parsed again.
+     */
+    void lineSpans(CTextStorage::TLineView text, unsigned char state, std::vector<TSpan> & spans) const override;
     std::string getFileExt() const override;
     bool needsColor() const override;
 
@@ -27,37 +36,113 @@ private:
         mid,
         end
     };
+    /**
+     * States of the parser at the beginning of a line (see CLineStates).
+     */
+    enum EState {
+        plain = 0,
+        backticks, // inside code block fenced by ```
+        tildes, // inside code block fenced by ~~~
+        comment // inside HTML comment (<!-- -->)
+    };
     struct TDivider {
         wchar_t div; // char representing divider
         int cnt; // how many of them are in row (in markdown it is only 1 or 2)
         size_t idx;
         EType type; // 0 = divider is a beginning of format block, 1 = divider can be both, 2 = divider is end of block
+        bool used; // true if divider has already been matched
     };
 
+    /**
+     * Bound of a span (used when spans are converted to runs).
+     */
+    struct TBound {
+        size_t idx; // index of the char
+        int attr; // attribute of the span
+        short color; // color of the span
+        bool open; // true for beginning of the span, false for it's end
+    };
+
+    /**
+     * Spans of one line, that have already been computed.
+     */
+    struct TCacheEntry {
+        uint64_t hash; // hash of the text of the line (and of the state)
+        size_t len; // length of the line
+        unsigned char state; // state at the beginning of the line
+        bool valid;
+        std::vector<TSpan> spans; // runs
+    };
+
+    mutable std::vector<TDivider> m_Dividers; // reused by boldItalic(), so that formatting does not allocate memory
+    mutable std::vector<TBound> m_Bounds; // reused by toRuns()
+    mutable std::vector<TCacheEntry> m_Cache; // indexed by hash of the line, allocated by first lineSpans()
+    static const size_t m_CacheSize = 512; // number of cached lines (few screens)
+
+    /**
+     * @param[in] text Text of the line.
+     * @return backticks or tildes if the line is a fence of code block, plain if it is not.
+     */
+    static unsigned char fence(CTextStorage::TLineView text);
+
+    /**
+     * Finds HTML comments (<!-- -->) on the line.
+     * @param[in] text Text of the line.
+     * @param[in] inside True if the line begins inside a comment.
+     * @param[out] spans Spans, to which comments are added (nullptr if they are not needed).
+     * @return True if the line ends inside a comment.
+     */
+    static bool comments(CTextStorage::TLineView text, bool inside, std::vector<TSpan> * spans);
+
+    /**
+     * Converts spans found by the parser to runs (in O(n log n), n = number of spans).
+     * @param[in, out] spans Spans of one line.
+     * @param[in, out] bounds Vector used for bounds of the spans (it's previous content is removed).
+     */
+    static void toRuns(std::vector<TSpan> & spans, std::vector<TBound> & bounds);
+
+    /**
+     * @return FNV-1a hash of given text and state.
+     */
+    static uint64_t hashLine(CTextStorage::TLineView text, unsigned char state);
+
+    /**
+     * @return Char at given index of the text, '\0' if index is out of range.
+     */
+    static wchar_t charAt(CTextStorage::TLineView text, size_t idx);
+
     /**
      * Determines if line has special format.
+     * @param[in] text Text of the line.
+     * @param[out] spans Spans, to which format of the line is added.
      * @return True if line has special format and no other formatting should be applied.
      */
-    static bool specialFormat(const CTextStorage & storage, CWindow & window, unsigned int line);
+    static bool specialFormat(CTextStorage::TLineView text, std::vector<TSpan> & spans);
 
     // all these functions are part of special format
-    static bool heading(const CTextStorage & storage, CWindow & window, unsigned int line);
-    static bool numList(const CTextStorage & storage, CWindow & window, unsigned int line);
-    static bool quote(const CTextStorage & storage, CWindow & window, unsigned int line);
-    static bool bulletList(const CTextStorage & storage, CWindow & window, unsigned int line);
-    static bool lineSep(const CTextStorage & storage, CWindow & window, unsigned int line);
+    static bool heading(CTextStorage::TLineView text, std::vector<TSpan> & spans);
+    static bool numList(CTextStorage::TLineView text, std::vector<TSpan> & spans);
+    static bool quote(CTextStorage::TLineView text, std::vector<TSpan> & spans);
+    static bool bulletList(CTextStorage::TLineView text, std::vector<TSpan> & spans);
+    static bool lineSep(CTextStorage::TLineView text, std::vector<TSpan> & spans);
 
     /**
-     * Applies bold and italic formatting.
+     * Finds bold and italic formatting. Each divider, that can begin a block, is matched (from the left) with the first
+     * following divider of the same kind, that can end a block and has not been matched yet. Matching takes O(n) time
+     * (n = length of the line), because search for the end of a block of each kind continues where it has stopped.
+     * @param[in] text Text of the line.
+     * @param[out] spans Spans, to which bold and italic text is added.
+     * @param[in, out] divs Vector used for dividers of the line (it's previous content is removed).
      */
-    static void boldItalic(const CTextStorage & storage, CWindow & window, unsigned int line);
+    static void boldItalic(CTextStorage::TLineView text, std::vector<TSpan> & spans, std::vector<TDivider> & divs);
 
     /**
      * Finds all dividers (for bold and italic formatting) on line.
      * @param[in, out] dividers Vector of TDividers, that will be filled.
      * @param[in] text Line on which dividers should be searched.
+     * @param[in] max Length of the line (at least 3).
      */
-    static void fillDividers(std::vector<TDivider> & dividers, const std::wstring & text);
+    static void fillDividers(std::vector<TDivider> & dividers, const wchar_t * text, size_t max);
 
     /**
      * Determines if two dividers match.
@@ -67,16 +152,6 @@ private:
      */
     static bool divMatch(TDivider & a, TDivider & b);
 
-    /**
-     * Applies bold and italic formatting.
-     * @param b Beginning divider.
-     * @param e Ending divider.
-     * @param count Dividers count (* or _ = 1, ** or __ = 2)
-     */
-    static void
-    applyBoldItalic(size_t b, size_t e, int count, const CTextStorage & storage, CWindow & window,
-                    unsigned int line);
-
     /**
      * @param[in] count Dividers count (* or _ = 1, ** or __ = 2)
      * @return Formatting that should be applied (as defined by ncurses)
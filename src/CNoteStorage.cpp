@@ -6,6 +6,7 @@
 #include "CNoteStorage.h"
 #include "CConverter.h"
 #include "CFile.h"
+#include "CAtomicFile.h"
 
 #include <fstream>
 #include <string>
@@ -24,20 +25,18 @@ CNoteStorage::~CNoteStorage() {
 }
 
 void CNoteStorage::save() const {
-    std::string filename = m_Folder + '/' + m_SaveFile;
-    std::ofstream out(filename);
-    if (!out.is_open()) {
-        return;
-    }
-
+    std::string data;
     for (const auto & note : m_Notes) {
-        out << CConverter::toString(note -> getName() + L'|');
-        out << CConverter::toString(note -> getCategory() + L'|');
+        data += CConverter::toString(note -> getName() + L'|');
+        data += CConverter::toString(note -> getCategory() + L'|');
         for (const auto & tag : note -> getTags())
-            out << CConverter::toString(tag) << ' ';
-        out << '\n';
+            data += CConverter::toString(tag) + ' ';
+        data += '\n';
     }
-    out.close();
+
+    CAtomicFile file(m_Folder + '/' + m_SaveFile); // old file stays untouched, if saving fails
+    file.write(data.data(), data.size());
+    file.commit();
 }
 
 void CNoteStorage::load() {
@@ -0,0 +1,336 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CPieceTable.h"
+
+#include <algorithm>
+#include <atomic>
+
+CPieceTable::CPieceTable(const std::shared_ptr<const CMappedFile> & original)
+                        : m_Mapping(original), m_Original(original ? original -> data() : ""), m_OrigLoaded(0),
+                          m_AddedSize(0), m_OrigBreaks(std::make_shared<std::vector<size_t>>()),
+                          m_AddBreaks(std::make_shared<std::vector<size_t>>()), m_Size(0), m_Breaks(0),
+                          m_IndexValid(false) {}
+
+CPieceTable::CPieceTable(const CPieceTable & table)
+                        : CTextBuffer(), m_Mapping(table.m_Mapping), m_Original(table.m_Original),
+                          m_OrigLoaded(table.m_OrigLoaded), m_Blocks(table.m_Blocks), m_AddedSize(table.m_AddedSize),
+                          m_OrigBreaks(table.m_OrigBreaks), m_AddBreaks(table.m_AddBreaks), m_Pieces(table.m_Pieces),
+                          m_Size(table.m_Size), m_Breaks(table.m_Breaks), m_IndexValid(false) {}
+
+size_t CPieceTable::size() const {
+    return m_Size;
+}
+
+size_t CPieceTable::lineCount() const {
+    return m_Breaks + 1;
+}
+
+size_t CPieceTable::lineStart(size_t line) const {
+    if (line == 0)
+        return 0;
+    buildIndex();
+    size_t chunk = m_ChunkBreaks.lowerBound(line); // line starts inside of this chunk
+    if (chunk == m_Chunks.size())
+        return m_Size;
+    line -= m_ChunkBreaks.prefix(chunk);
+    size_t pos = m_ChunkBytes.prefix(chunk);
+    size_t idx = m_ChunkPieces.prefix(chunk);
+    for (; m_Pieces[idx].breaks < line; ++idx) {
+        line -= m_Pieces[idx].breaks;
+        pos += m_Pieces[idx].len;
+    }
+    const TPiece & piece = m_Pieces[idx]; // line starts after line-th '\n' of the piece
+    const auto & breaks = piece.added ? *m_AddBreaks : *m_OrigBreaks;
+    auto it = std::lower_bound(breaks.begin(), breaks.end(), piece.start) + (line - 1);
+    return pos + (*it - piece.start) + 1;
+}
+
+void CPieceTable::insert(size_t pos, const char * text, size_t len) {
+    while (len > 0) { // text that does not fit into current block of add buffer is split to more pieces
+        size_t addStart;
+        size_t added = appendAdded(text, len, addStart);
+        insertPiece(pos, addStart, added);
+        pos += added;
+        text += added;
+        len -= added;
+    }
+}
+
+std::shared_ptr<const CTextBuffer> CPieceTable::snapshot() const {
+    return std::make_shared<CPieceTable>(*this); // only the object, list of blocks and pieces are allocated
+}
+
+void CPieceTable::memoryStats(TMemoryStats & stats) const {
+    stats.payload += m_AddedSize;
+    stats.mapped += m_OrigLoaded;
+    // every block is allocated as vector object, it's data and shared_ptr control block
+    stats.overhead += m_Blocks.size() * (m_BlockSize + sizeof(std::vector<char>)) - m_AddedSize
+                      + m_Blocks.capacity() * sizeof(m_Blocks[0]);
+    stats.allocations += 3 * m_Blocks.size() + 1;
+    stats.overhead += (m_OrigBreaks -> capacity() + m_AddBreaks -> capacity()) * sizeof(size_t);
+    stats.allocations += 4;
+    stats.overhead += m_Pieces.capacity() * sizeof(TPiece) + m_Chunks.capacity() * sizeof(TChunk)
+                      + 3 * (m_ChunkPieces.size() + 1) * sizeof(size_t);
+    stats.allocations += 5;
+}
+
+size_t CPieceTable::appendAdded(const char * text, size_t len, size_t & start) {
+    if (m_AddedSize == m_Blocks.size() * m_BlockSize) // last block is full
+        m_Blocks.emplace_back(new std::vector<char>(m_BlockSize));
+    size_t added = std::min(len, m_Blocks.size() * m_BlockSize - m_AddedSize);
+    start = m_AddedSize;
+    std::copy(text, text + added, m_Blocks.back() -> data() + start % m_BlockSize);
+
+    if (m_AddBreaks.use_count() > 1) // breaks are shared with a snapshot
+        m_AddBreaks = std::make_shared<std::vector<size_t>>(*m_AddBreaks);
+    else // snapshot, that has shared them, may have been released by other thread just now (after reading them)
+        std::atomic_thread_fence(std::memory_order_acquire);
+    for (size_t i = 0; i < added; ++i)
+        if (text[i] == '\n')
+            m_AddBreaks -> push_back(start + i);
+    m_AddedSize += added;
+    return added;
+}
+
+void CPieceTable::insertPiece(size_t pos, size_t addStart, size_t len) {
+    size_t breaks = countBreaks(true, addStart, len);
+    m_Size += len;
+    m_Breaks += breaks;
+
+    size_t off = pos;
+    size_t idx = findPiece(off, true);
+    if (idx < m_Pieces.size() && off == m_Pieces[idx].len && m_Pieces[idx].added && addStart % m_BlockSize != 0
+        && m_Pieces[idx].start + m_Pieces[idx].len == addStart) { // typing continues right after previous insertion
+        m_Pieces[idx].len += len;
+        m_Pieces[idx].breaks += breaks;
+        pieceChanged(idx, len, breaks);
+        return;
+    }
+
+    TPiece piece{true, addStart, len, breaks};
+    if (idx == m_Pieces.size() || off == 0) {
+        m_Pieces.insert(m_Pieces.begin() + idx, piece);
+        pieceInserted(idx);
+        return;
+    }
+    if (off == m_Pieces[idx].len) {
+        m_Pieces.insert(m_Pieces.begin() + idx + 1, piece);
+        pieceInserted(idx + 1);
+        return;
+    }
+
+    // insertion in the middle of a piece -> piece must be split
+    TPiece & left = m_Pieces[idx];
+    TPiece right{left.added, left.start + off, left.len - off, countBreaks(left.added, left.start + off, left.len - off)};
+    left.len = off;
+    left.breaks -= right.breaks;
+    pieceChanged(idx, -(long long) right.len, -(long long) right.breaks);
+    m_Pieces.insert(m_Pieces.begin() + idx + 1, piece); // index must contain all pieces but the inserted one
+    pieceInserted(idx + 1);
+    m_Pieces.insert(m_Pieces.begin() + idx + 2, right);
+    pieceInserted(idx + 2);
+}
+
+void CPieceTable::erase(size_t pos, size_t len) {
+    size_t off = pos;
+    size_t idx = findPiece(off, false);
+
+    while (len > 0 && idx < m_Pieces.size()) {
+        TPiece & piece = m_Pieces[idx];
+        size_t take = std::min(len, piece.len - off);
+        size_t breaks = countBreaks(piece.added, piece.start + off, take);
+        m_Size -= take;
+        m_Breaks -= breaks;
+        len -= take;
+
+        if (off == 0 && take == piece.len) { // entire piece is erased
+            pieceErased(idx);
+            m_Pieces.erase(m_Pieces.begin() + idx);
+        }
+        else if (off == 0) { // beginning of piece is erased
+            piece.start += take;
+            piece.len -= take;
+            piece.breaks -= breaks;
+            pieceChanged(idx, -(long long) take, -(long long) breaks);
+        }
+        else if (off + take == piece.len) { // end of piece is erased
+            piece.len = off;
+            piece.breaks -= breaks;
+            pieceChanged(idx, -(long long) take, -(long long) breaks);
+            ++idx;
+            off = 0;
+        }
+        else { // middle of piece is erased -> piece must be split
+            size_t rightStart = off + take;
+            TPiece right{piece.added, piece.start + rightStart, piece.len - rightStart,
+                         countBreaks(piece.added, piece.start + rightStart, piece.len - rightStart)};
+            piece.breaks -= breaks + right.breaks;
+            piece.len = off;
+            pieceChanged(idx, -(long long) (take + right.len), -(long long) (breaks + right.breaks));
+            m_Pieces.insert(m_Pieces.begin() + idx + 1, right);
+            pieceInserted(idx + 1);
+        }
+    }
+}
+
+void CPieceTable::appendOriginal(size_t len, const std::vector<size_t> & breaks) {
+    if (len == 0)
+        return;
+    // only positions of '\n' are stored, lines themselves stay in the mapped file
+    if (m_OrigBreaks.use_count() > 1) // breaks are shared with a snapshot
+        m_OrigBreaks = std::make_shared<std::vector<size_t>>(*m_OrigBreaks);
+    else
+        std::atomic_thread_fence(std::memory_order_acquire);
+    m_OrigBreaks -> insert(m_OrigBreaks -> end(), breaks.begin(), breaks.end());
+    if (!m_Pieces.empty() && !m_Pieces.back().added && m_Pieces.back().start + m_Pieces.back().len == m_OrigLoaded) {
+        m_Pieces.back().len += len;
+        m_Pieces.back().breaks += breaks.size();
+        pieceChanged(m_Pieces.size() - 1, len, breaks.size());
+    }
+    else {
+        m_Pieces.push_back(TPiece{false, m_OrigLoaded, len, breaks.size()});
+        pieceInserted(m_Pieces.size() - 1);
+    }
+    m_OrigLoaded += len;
+    m_Size += len;
+    m_Breaks += breaks.size();
+}
+
+void CPieceTable::read(size_t pos, size_t len, std::string & out) const {
+    out.clear();
+    size_t off = pos;
+    size_t idx = findPiece(off, false);
+    for (; len > 0 && idx < m_Pieces.size(); ++idx) {
+        const TPiece & piece = m_Pieces[idx];
+        size_t take = std::min(len, piece.len - off);
+        out.append(text(piece, off), take);
+        len -= take;
+        off = 0;
+    }
+}
+
+size_t CPieceTable::countBreaks(bool added, size_t start, size_t len) const {
+    const auto & breaks = added ? *m_AddBreaks : *m_OrigBreaks;
+    return std::lower_bound(breaks.begin(), breaks.end(), start + len)
+           - std::lower_bound(breaks.begin(), breaks.end(), start);
+}
+
+size_t CPieceTable::findPiece(size_t & pos, bool preferEnd) const {
+    buildIndex();
+    size_t value = preferEnd ? pos : pos + 1; // piece, where length of the text up to it's end reaches value, is found
+    size_t chunk = m_ChunkBytes.lowerBound(value);
+    value -= m_ChunkBytes.prefix(chunk);
+    size_t idx = m_ChunkPieces.prefix(chunk);
+    if (chunk < m_Chunks.size())
+        for (; m_Pieces[idx].len < value; ++idx)
+            value -= m_Pieces[idx].len;
+    pos = preferEnd ? value : value - 1;
+    return idx;
+}
+
+void CPieceTable::buildIndex() const {
+    if (m_IndexValid)
+        return;
+    m_Chunks.clear();
+    for (size_t first = 0; first < m_Pieces.size(); first += m_ChunkSize) {
+        TChunk chunk{std::min(first + m_ChunkSize, m_Pieces.size()) - first, 0, 0};
+        for (size_t idx = first; idx < first + chunk.pieces; ++idx) {
+            chunk.bytes += m_Pieces[idx].len;
+            chunk.breaks += m_Pieces[idx].breaks;
+        }
+        m_Chunks.push_back(chunk);
+    }
+    buildTrees();
+    m_IndexValid = true;
+}
+
+void CPieceTable::buildTrees() const {
+    std::vector<size_t> pieces, bytes, breaks;
+    pieces.reserve(m_Chunks.size());
+    bytes.reserve(m_Chunks.size());
+    breaks.reserve(m_Chunks.size());
+    for (const auto & chunk : m_Chunks) {
+        pieces.push_back(chunk.pieces);
+        bytes.push_back(chunk.bytes);
+        breaks.push_back(chunk.breaks);
+    }
+    m_ChunkPieces.assign(pieces);
+    m_ChunkBytes.assign(bytes);
+    m_ChunkBreaks.assign(breaks);
+}
+
+size_t CPieceTable::chunkOf(size_t idx) const {
+    return m_ChunkPieces.lowerBound(idx + 1);
+}
+
+void CPieceTable::pieceChanged(size_t idx, long long bytes, long long breaks) {
+    if (!m_IndexValid)
+        return;
+    size_t chunk = chunkOf(idx);
+    m_Chunks[chunk].bytes += bytes;
+    m_Chunks[chunk].breaks += breaks;
+    m_ChunkBytes.add(chunk, bytes);
+    m_ChunkBreaks.add(chunk, breaks);
+}
+
+void CPieceTable::pieceInserted(size_t idx) {
+    if (!m_IndexValid)
+        return;
+    if (m_Chunks.empty()) { // the only chunk is created for the piece
+        m_Chunks.push_back(TChunk{0, 0, 0});
+        buildTrees();
+    }
+    // piece behind the last one is added to the last chunk, other pieces to the chunk of the piece they were put before
+    size_t chunk = idx < m_ChunkPieces.prefix(m_Chunks.size()) ? chunkOf(idx) : m_Chunks.size() - 1;
+    const TPiece & piece = m_Pieces[idx];
+    TChunk & target = m_Chunks[chunk];
+    ++target.pieces;
+    target.bytes += piece.len;
+    target.breaks += piece.breaks;
+    if (target.pieces <= 2 * m_ChunkSize) {
+        m_ChunkPieces.add(chunk, 1);
+        m_ChunkBytes.add(chunk, piece.len);
+        m_ChunkBreaks.add(chunk, piece.breaks);
+        return;
+    }
+
+    // chunk is split in halves
+    size_t first = m_ChunkPieces.prefix(chunk); // index of the first piece of the chunk
+    TChunk left{target.pieces / 2, 0, 0};
+    for (size_t i = first; i < first + left.pieces; ++i) {
+        left.bytes += m_Pieces[i].len;
+        left.breaks += m_Pieces[i].breaks;
+    }
+    TChunk right{target.pieces - left.pieces, target.bytes - left.bytes, target.breaks - left.breaks};
+    target = left;
+    m_Chunks.insert(m_Chunks.begin() + chunk + 1, right);
+    buildTrees();
+}
+
+void CPieceTable::pieceErased(size_t idx) {
+    if (!m_IndexValid)
+        return;
+    size_t chunk = chunkOf(idx);
+    const TPiece & piece = m_Pieces[idx];
+    TChunk & source = m_Chunks[chunk];
+    --source.pieces;
+    source.bytes -= piece.len;
+    source.breaks -= piece.breaks;
+    if (source.pieces == 0) {
+        m_Chunks.erase(m_Chunks.begin() + chunk);
+        buildTrees();
+        return;
+    }
+    m_ChunkPieces.add(chunk, -1);
+    m_ChunkBytes.add(chunk, -(long long) piece.len);
+    m_ChunkBreaks.add(chunk, -(long long) piece.breaks);
+}
+
+const char * CPieceTable::text(const TPiece & piece, size_t off) const {
+    if (!piece.added)
+        return m_Original + piece.start + off;
+    return m_Blocks[piece.start / m_BlockSize] -> data() + piece.start % m_BlockSize + off;
+}
@@ -0,0 +1,160 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include "CTextBuffer.h"
+#include "CMappedFile.h"
+#include "CFenwickTree.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * CTextBuffer implemented as a piece table. Loaded text is stored in immutable original buffer, everything that is typed
+ * is appended to add buffer (nothing is ever erased from either of them). Text itself is described by ordered list of
+ * pieces - spans of one of the buffers. Editing therefore never moves the rest of the text, only pieces are split.
+ * Original buffer is memory mapped file, so it is never copied - only edited text is stored in memory. Add buffer is
+ * split to blocks of fixed size, that are never reallocated, so snapshots can share them with the table.
+ * Pieces are indexed in chunks of at most 2 * m_ChunkSize consecutive pieces, numbers of pieces, bytes and '\n' of
+ * chunks are kept in CFenwickTrees. Position and line lookups are therefore O(log n + m_ChunkSize) in number of pieces.
+ * Adding, removing or changing of a piece updates the trees in O(log n), they are rebuilt from the chunks
+ * (O(n / m_ChunkSize)) only when a chunk is split or removed. List of pieces itself is a plain vector, so adding or
+ * removing of a piece moves pieces behind it.
+ */
+class CPieceTable : public CTextBuffer {
+public:
+    /**
+     * Creates new empty piece table.
+     * @param[in] original File that will be used as original (immutable) buffer, use appendOriginal() to add it's
+     * content to the text.
+     */
+    explicit CPieceTable(const std::shared_ptr<const CMappedFile> & original = nullptr);
+
+    /**
+     * Creates copy of given table, that shares buffers and breaks with it (see snapshot()). Index is not copied, it is
+     * built when the copy is read for the first time (so that snapshot allocates as little memory as possible).
+     * @param[in] table Copied table.
+     */
+    CPieceTable(const CPieceTable & table);
+    ~CPieceTable() override = default;
+
+    size_t size() const override;
+    size_t lineCount() const override;
+    size_t lineStart(size_t line) const override;
+    void insert(size_t pos, const char * text, size_t len) override;
+    void erase(size_t pos, size_t len) override;
+    void appendOriginal(size_t len, const std::vector<size_t> & breaks) override;
+    void read(size_t pos, size_t len, std::string & out) const override;
+    std::shared_ptr<const CTextBuffer> snapshot() const override;
+    void memoryStats(TMemoryStats & stats) const override;
+
+private:
+    struct TPiece {
+        bool added; // true if piece points to add buffer, false if to original buffer
+        size_t start; // position of piece in it's buffer
+        size_t len;
+        size_t breaks; // number of '\n' in piece
+    };
+
+    struct TChunk {
+        size_t pieces; // number of consecutive pieces of the chunk
+        size_t bytes; // length of all pieces of the chunk
+        size_t breaks; // number of '\n' in all pieces of the chunk
+    };
+
+    static const size_t m_BlockSize = 64 * 1024; // size of one block of add buffer
+    static const size_t m_ChunkSize = 64; // number of pieces of a new chunk, chunk is split when it has twice as many
+
+    const std::shared_ptr<const CMappedFile> m_Mapping; // keeps original buffer alive
+    const char * m_Original;
+    size_t m_OrigLoaded; // number of bytes of original buffer, that have been appended to the text
+    std::vector<std::shared_ptr<std::vector<char>>> m_Blocks; // add buffer (position p is in block p / m_BlockSize)
+    size_t m_AddedSize; // number of bytes used in add buffer
+    // breaks are copied before change, if they are shared with a snapshot
+    std::shared_ptr<std::vector<size_t>> m_OrigBreaks; // positions of all '\n' in m_Original (sorted)
+    std::shared_ptr<std::vector<size_t>> m_AddBreaks; // positions of all '\n' in add buffer (sorted)
+    std::vector<TPiece> m_Pieces;
+    size_t m_Size;
+    size_t m_Breaks; // number of '\n' in the entire text
+    mutable std::vector<TChunk> m_Chunks; // pieces in order (there are no empty chunks)
+    mutable CFenwickTree m_ChunkPieces; // number of pieces of every chunk
+    mutable CFenwickTree m_ChunkBytes; // length of every chunk
+    mutable CFenwickTree m_ChunkBreaks; // number of '\n' in every chunk
+    mutable bool m_IndexValid; // false if index has not been built yet (new table or copy)
+
+    /**
+     * Splits pieces into chunks and builds the trees, if index is not valid.
+     */
+    void buildIndex() const;
+
+    /**
+     * Rebuilds the trees from the chunks (after a chunk has been split or removed).
+     */
+    void buildTrees() const;
+
+    /**
+     * @param[in] idx Index of piece.
+     * @return Index of chunk, that contains given piece.
+     */
+    size_t chunkOf(size_t idx) const;
+
+    /**
+     * Updates index after length of a piece has been changed.
+     * @param[in] idx Index of changed piece.
+     * @param[in] bytes Change of piece length.
+     * @param[in] breaks Change of number of '\n' in piece.
+     */
+    void pieceChanged(size_t idx, long long bytes, long long breaks);
+
+    /**
+     * Updates index after piece has been inserted to the list, index must not contain it yet.
+     * @param[in] idx Index of inserted piece (pieces behind it have already been moved).
+     */
+    void pieceInserted(size_t idx);
+
+    /**
+     * Updates index before piece is removed from the list.
+     * @param[in] idx Index of removed piece.
+     */
+    void pieceErased(size_t idx);
+
+    /**
+     * @return Number of '\n' in given span of given buffer.
+     */
+    size_t countBreaks(bool added, size_t start, size_t len) const;
+
+    /**
+     * Finds piece containing given position.
+     * @param[in, out] pos Position in text, will be changed to position inside of found piece.
+     * @param[in] preferEnd If position lies on the border of two pieces, end of the left piece is returned when true,
+     * beginning of the right piece when false.
+     * @return Index of found piece (m_Pieces.size() if position is at the end of text and preferEnd is false).
+     */
+    size_t findPiece(size_t & pos, bool preferEnd) const;
+
+    /**
+     * Appends text to add buffer, as much of it as fits into the current block.
+     * @param[in] text Text to append.
+     * @param[in] len Length of text.
+     * @param[out] start Position of appended text in add buffer.
+     * @return Number of appended bytes.
+     */
+    size_t appendAdded(const char * text, size_t len, size_t & start);
+
+    /**
+     * Inserts piece pointing to add buffer to given position in text.
+     * @param[in] pos Position in text.
+     * @param[in] addStart Position of piece in add buffer.
+     * @param[in] len Length of piece.
+     */
+    void insertPiece(size_t pos, size_t addStart, size_t len);
+
+    /**
+     * @return Pointer to given byte of given piece.
+     */
+    const char * text(const TPiece & piece, size_t off) const;
+};
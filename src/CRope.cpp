@@ -0,0 +1,282 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CRope.h"
+
+#include <algorithm>
+#include <cstring>
+
+CRope::CRope(const std::shared_ptr<const CMappedFile> & original) : m_Mapping(original), m_Root(makeLeaf("", 0)) {}
+
+size_t CRope::size() const {
+    return m_Root -> bytes;
+}
+
+size_t CRope::lineCount() const {
+    return m_Root -> breaks + 1;
+}
+
+size_t CRope::lineStart(size_t line) const {
+    if (line == 0)
+        return 0;
+    if (line > m_Root -> breaks)
+        return size();
+
+    size_t pos = 0;
+    const TNode * node = m_Root.get();
+    while (!node -> children.empty()) { // descend to the leaf containing line-th '\n'
+        for (const auto & child : node -> children) {
+            if (line <= child -> breaks) {
+                node = child.get();
+                break;
+            }
+            line -= child -> breaks;
+            pos += child -> bytes;
+        }
+    }
+
+    const char * text = node -> data;
+    const char * end = text + node -> bytes;
+    const char * found = text;
+    for (; line > 0; --line)
+        found = (const char *) memchr(found, '\n', end - found) + 1;
+    return pos + (found - text);
+}
+
+void CRope::insert(size_t pos, const char * text, size_t len) {
+    if (len == 0)
+        return;
+    m_Root = buildRoot(insert(m_Root, std::min(pos, size()), text, len));
+}
+
+void CRope::erase(size_t pos, size_t len) {
+    if (pos >= size() || len == 0)
+        return;
+    m_Root = erase(m_Root, pos, std::min(len, size() - pos));
+    if (!m_Root)
+        m_Root = makeLeaf("", 0);
+    while (m_Root -> children.size() == 1) // tree height is decreased if possible
+        m_Root = m_Root -> children[0];
+}
+
+void CRope::appendOriginal(size_t len, const std::vector<size_t> & breaks) {
+    if (len == 0)
+        return;
+    std::vector<TNodePtr> leaves;
+    makeLeaves(m_Mapping -> data() + m_OrigLoaded, len, true, leaves, &breaks, m_OrigLoaded);
+    m_OrigLoaded += len;
+    if (m_Root -> bytes == 0)
+        m_Root = buildRoot(std::move(leaves));
+    else
+        m_Root = buildRoot(append(m_Root, leaves));
+}
+
+void CRope::read(size_t pos, size_t len, std::string & out) const {
+    out.clear();
+    if (pos >= size())
+        return;
+    out.reserve(std::min(len, size() - pos));
+    read(m_Root, pos, len, out);
+}
+
+std::shared_ptr<const CTextBuffer> CRope::snapshot() const {
+    auto copy = std::make_shared<CRope>(m_Mapping);
+    copy -> m_OrigLoaded = m_OrigLoaded;
+    copy -> m_Root = m_Root; // nodes are immutable, so they can be shared
+    return copy;
+}
+
+void CRope::memoryStats(TMemoryStats & stats) const {
+    memoryStats(m_Root, stats);
+}
+
+CRope::TNodePtr CRope::makeLeaf(const char * text, size_t len, bool view, size_t breaks) {
+    auto leaf = std::make_shared<TNode>();
+    if (view)
+        leaf -> data = text;
+    else {
+        leaf -> text.assign(text, len);
+        leaf -> data = leaf -> text.data();
+    }
+    leaf -> bytes = len;
+    leaf -> breaks = breaks == m_Unknown ? countBreaks(text, len) : breaks;
+    return leaf;
+}
+
+CRope::TNodePtr CRope::makeInner(std::vector<TNodePtr>::const_iterator begin,
+                                 std::vector<TNodePtr>::const_iterator end) {
+    auto node = std::make_shared<TNode>();
+    node -> bytes = 0;
+    node -> breaks = 0;
+    node -> data = nullptr;
+    for (auto it = begin; it != end; ++it) {
+        node -> bytes += (*it) -> bytes;
+        node -> breaks += (*it) -> breaks;
+    }
+    node -> children.assign(begin, end);
+    return node;
+}
+
+void CRope::makeLeaves(const char * text, size_t len, bool view, std::vector<TNodePtr> & out,
+                       const std::vector<size_t> * breaks, size_t base) {
+    size_t count = (len + m_MaxLeaf - 1) / m_MaxLeaf;
+    size_t chunk = (len + count - 1) / count; // leaves are of (almost) the same size
+    for (size_t pos = 0; pos < len; pos += chunk) {
+        size_t leafLen = std::min(chunk, len - pos);
+        size_t leafBreaks = m_Unknown;
+        if (breaks)
+            leafBreaks = std::lower_bound(breaks -> begin(), breaks -> end(), base + pos + leafLen)
+                         - std::lower_bound(breaks -> begin(), breaks -> end(), base + pos);
+        out.push_back(makeLeaf(text + pos, leafLen, view, leafBreaks));
+    }
+}
+
+std::vector<CRope::TNodePtr> CRope::group(const std::vector<TNodePtr> & nodes) {
+    std::vector<TNodePtr> parents;
+    size_t count = (nodes.size() + m_MaxChildren - 1) / m_MaxChildren;
+    size_t chunk = (nodes.size() + count - 1) / count;
+    for (size_t i = 0; i < nodes.size(); i += chunk)
+        parents.push_back(makeInner(nodes.begin() + i, nodes.begin() + std::min(i + chunk, nodes.size())));
+    return parents;
+}
+
+CRope::TNodePtr CRope::buildRoot(std::vector<TNodePtr> nodes) {
+    while (nodes.size() > 1)
+        nodes = group(nodes);
+    return nodes[0];
+}
+
+std::vector<CRope::TNodePtr> CRope::insert(const TNodePtr & node, size_t pos, const char * text, size_t len) {
+    std::vector<TNodePtr> res;
+    if (node -> children.empty()) {
+        std::string joined;
+        joined.reserve(node -> bytes + len);
+        joined.append(node -> data, pos);
+        joined.append(text, len);
+        joined.append(node -> data + pos, node -> bytes - pos);
+        makeLeaves(joined.data(), joined.size(), false, res);
+        return res;
+    }
+
+    std::vector<TNodePtr> children;
+    children.reserve(node -> children.size() + 1);
+    size_t idx = 0;
+    for (; idx + 1 < node -> children.size() && pos > node -> children[idx] -> bytes; ++idx)
+        pos -= node -> children[idx] -> bytes; // pos at the border of two children goes to the left one
+    children.insert(children.end(), node -> children.begin(), node -> children.begin() + idx);
+    auto replaced = insert(node -> children[idx], pos, text, len);
+    children.insert(children.end(), replaced.begin(), replaced.end());
+    children.insert(children.end(), node -> children.begin() + idx + 1, node -> children.end());
+
+    if (children.size() <= m_MaxChildren)
+        res.push_back(makeInner(children.begin(), children.end()));
+    else
+        res = group(children);
+    return res;
+}
+
+std::vector<CRope::TNodePtr> CRope::append(const TNodePtr & node, const std::vector<TNodePtr> & leaves) {
+    std::vector<TNodePtr> res;
+    if (node -> children.empty()) { // leaves become siblings of the last leaf
+        res.push_back(node);
+        res.insert(res.end(), leaves.begin(), leaves.end());
+        return res;
+    }
+    std::vector<TNodePtr> children(node -> children.begin(), node -> children.end() - 1);
+    auto replaced = append(node -> children.back(), leaves);
+    children.insert(children.end(), replaced.begin(), replaced.end());
+    if (children.size() <= m_MaxChildren)
+        res.push_back(makeInner(children.begin(), children.end()));
+    else
+        res = group(children);
+    return res;
+}
+
+CRope::TNodePtr CRope::erase(const TNodePtr & node, size_t pos, size_t len) {
+    if (pos == 0 && len >= node -> bytes)
+        return nullptr;
+
+    if (node -> children.empty()) {
+        std::string text(node -> data, pos);
+        text.append(node -> data + pos + len, node -> bytes - pos - len);
+        return makeLeaf(text.data(), text.size());
+    }
+
+    std::vector<TNodePtr> children;
+    children.reserve(node -> children.size());
+    for (const auto & child : node -> children) {
+        if (len == 0 || pos >= child -> bytes) { // child is not affected
+            children.push_back(child);
+            pos -= std::min(pos, child -> bytes);
+            continue;
+        }
+        size_t take = std::min(len, child -> bytes - pos);
+        auto replaced = erase(child, pos, take);
+        if (replaced)
+            children.push_back(replaced);
+        len -= take;
+        pos = 0;
+    }
+    if (children.empty())
+        return nullptr;
+    mergeLeaves(children);
+    return makeInner(children.begin(), children.end());
+}
+
+void CRope::mergeLeaves(std::vector<TNodePtr> & children) {
+    for (size_t i = 0; i + 1 < children.size();) {
+        const auto & a = children[i];
+        const auto & b = children[i + 1];
+        if (!a -> children.empty() || !b -> children.empty() || a -> bytes + b -> bytes > m_MaxLeaf) {
+            ++i;
+            continue;
+        }
+        std::string text(a -> data, a -> bytes);
+        text.append(b -> data, b -> bytes);
+        children[i] = makeLeaf(text.data(), text.size());
+        children.erase(children.begin() + i + 1);
+    }
+}
+
+void CRope::read(const TNodePtr & node, size_t pos, size_t len, std::string & out) {
+    if (node -> children.empty()) {
+        out.append(node -> data + pos, std::min(len, node -> bytes - pos));
+        return;
+    }
+    for (const auto & child : node -> children) {
+        if (len == 0)
+            return;
+        if (pos >= child -> bytes) {
+            pos -= child -> bytes;
+            continue;
+        }
+        size_t take = std::min(len, child -> bytes - pos);
+        read(child, pos, take, out);
+        len -= take;
+        pos = 0;
+    }
+}
+
+size_t CRope::countBreaks(const char * text, size_t len) {
+    return std::count(text, text + len, '\n');
+}
+
+void CRope::memoryStats(const TNodePtr & node, TMemoryStats & stats) {
+    stats.overhead += sizeof(TNode);
+    ++stats.allocations; // node and it's control block are allocated together by make_shared
+    if (!node -> children.empty()) {
+        stats.overhead += node -> children.capacity() * sizeof(TNodePtr);
+        ++stats.allocations;
+        for (const auto & child : node -> children)
+            memoryStats(child, stats);
+    }
+    else if (node -> text.empty())
+        stats.mapped += node -> bytes;
+    else {
+        stats.payload += node -> text.size();
+        stats.overhead += node -> text.capacity() - node -> text.size();
+        ++stats.allocations;
+    }
+}
@@ -0,0 +1,122 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include "CTextBuffer.h"
+#include "CMappedFile.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * CTextBuffer implemented as a balanced rope (B-tree of text chunks). Every node caches number of bytes and number of
+ * '\n' in it's subtree, so finding line or position, insertion and deletion are all O(log n). Text is stored in chunks
+ * of at most m_MaxLeaf bytes, memory overhead therefore does not depend on number of lines. Nodes are immutable and
+ * shared, every change creates new path from the root to the changed chunk. Chunks of loaded file point directly to
+ * the memory mapped file, only edited chunks are copied to memory.
+ */
+class CRope : public CTextBuffer {
+public:
+    /**
+     * Creates new empty rope.
+     * @param[in] original File with initial content of the rope, use appendOriginal() to add it's content to the text.
+     */
+    explicit CRope(const std::shared_ptr<const CMappedFile> & original = nullptr);
+    ~CRope() override = default;
+
+    size_t size() const override;
+    size_t lineCount() const override;
+    size_t lineStart(size_t line) const override;
+    void insert(size_t pos, const char * text, size_t len) override;
+    void erase(size_t pos, size_t len) override;
+    void appendOriginal(size_t len, const std::vector<size_t> & breaks) override;
+    void read(size_t pos, size_t len, std::string & out) const override;
+    std::shared_ptr<const CTextBuffer> snapshot() const override;
+    void memoryStats(TMemoryStats & stats) const override;
+
+private:
+    struct TNode;
+    typedef std::shared_ptr<const TNode> TNodePtr;
+
+    struct TNode {
+        size_t bytes; // number of bytes in subtree
+        size_t breaks; // number of '\n' in subtree
+        const char * data; // text of leaf, points either to text or to the mapped file
+        std::string text; // text of leaf, if it has been edited
+        std::vector<TNodePtr> children; // empty for leaves
+    };
+
+    static const size_t m_MaxLeaf = 2048; // max number of bytes in one leaf
+    static const size_t m_MaxChildren = 16; // max number of children of inner node
+    static const size_t m_Unknown = (size_t) -1;
+
+    const std::shared_ptr<const CMappedFile> m_Mapping; // keeps unedited leaves alive
+    size_t m_OrigLoaded = 0; // number of bytes of the mapped file, that have been appended to the text
+    TNodePtr m_Root;
+
+    /**
+     * Creates new leaf.
+     * @param[in] text Text of the leaf.
+     * @param[in] len Length of text.
+     * @param[in] view If true, text is not copied (text must outlive the leaf).
+     * @param[in] breaks Number of '\n' in text, if it is not known, they will be counted.
+     */
+    static TNodePtr makeLeaf(const char * text, size_t len, bool view = false, size_t breaks = m_Unknown);
+    static TNodePtr makeInner(std::vector<TNodePtr>::const_iterator begin, std::vector<TNodePtr>::const_iterator end);
+
+    /**
+     * Splits given text to leaves (leaves are appended to out).
+     * @param[in] breaks Positions of all '\n' in text (relative to base), if nullptr '\n' will be counted.
+     * @param[in] base Position of text, that is used in breaks.
+     */
+    static void makeLeaves(const char * text, size_t len, bool view, std::vector<TNodePtr> & out,
+                           const std::vector<size_t> * breaks = nullptr, size_t base = 0);
+
+    /**
+     * Groups given nodes to as few nodes of one level above, as possible (every group has at most m_MaxChildren).
+     * @param[in] nodes Nodes to group.
+     * @return Parent nodes.
+     */
+    static std::vector<TNodePtr> group(const std::vector<TNodePtr> & nodes);
+
+    /**
+     * Creates new root from given nodes (nodes of one level).
+     */
+    static TNodePtr buildRoot(std::vector<TNodePtr> nodes);
+
+    /**
+     * Inserts text to given subtree.
+     * @return Nodes that replace given node (more than one if node had to be split).
+     */
+    static std::vector<TNodePtr> insert(const TNodePtr & node, size_t pos, const char * text, size_t len);
+
+    /**
+     * Appends given leaves to the end of given subtree.
+     * @return Nodes that replace given node (more than one if node had to be split).
+     */
+    static std::vector<TNodePtr> append(const TNodePtr & node, const std::vector<TNodePtr> & leaves);
+
+    /**
+     * Erases range of bytes from given subtree.
+     * @return Node that replaces given node, nullptr if entire subtree was erased.
+     */
+    static TNodePtr erase(const TNodePtr & node, size_t pos, size_t len);
+
+    /**
+     * Merges neighbouring small leaves, so that memory overhead stays bounded after deletions.
+     */
+    static void mergeLeaves(std::vector<TNodePtr> & children);
+
+    static void read(const TNodePtr & node, size_t pos, size_t len, std::string & out);
+
+    static size_t countBreaks(const char * text, size_t len);
+
+    /**
+     * Adds memory used by given subtree to given stats.
+     */
+    static void memoryStats(const TNodePtr & node, TMemoryStats & stats);
+};
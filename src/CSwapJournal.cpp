@@ -0,0 +1,134 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CSwapJournal.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char CSwapJournal::m_Magic[8] = {'N', 'P', 'S', 'W', 'P', '0', '1', '\n'};
+
+CSwapJournal::CSwapJournal(const std::string & fileName, const std::string & noteFile)
+        : m_FileName(fileName), m_LastFlush(std::chrono::steady_clock::now()) {
+    m_Fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+    m_Buffer = header(noteFile);
+    flush(true);
+}
+
+CSwapJournal::~CSwapJournal() {
+    flush(true);
+    if (m_Fd != -1)
+        ::close(m_Fd);
+}
+
+void CSwapJournal::recordInsert(size_t pos, const std::string & text) {
+    m_Buffer += 'I';
+    writeNumber(pos, m_Buffer);
+    writeNumber(text.size(), m_Buffer);
+    m_Buffer += text;
+}
+
+void CSwapJournal::recordErase(size_t pos, size_t len) {
+    m_Buffer += 'E';
+    writeNumber(pos, m_Buffer);
+    writeNumber(len, m_Buffer);
+}
+
+void CSwapJournal::flush(bool force) {
+    auto now = std::chrono::steady_clock::now();
+    if (m_Buffer.empty() || (!force && m_Buffer.size() < m_FlushSize
+                             && std::chrono::duration_cast<std::chrono::milliseconds>(now - m_LastFlush).count()
+                                < m_FlushInterval))
+        return;
+    // process crash does not lose written data, they are in the page cache
+    for (size_t done = 0; m_Fd != -1 && done < m_Buffer.size();) {
+        ssize_t written = ::write(m_Fd, m_Buffer.data() + done, m_Buffer.size() - done);
+        if (written <= 0) {
+            ::close(m_Fd); // broken journal is not written anymore
+            m_Fd = -1;
+            break;
+        }
+        done += written;
+    }
+    m_Buffer.clear();
+    m_LastFlush = now;
+}
+
+void CSwapJournal::remove() {
+    m_Buffer.clear();
+    if (m_Fd != -1)
+        ::close(m_Fd);
+    m_Fd = -1;
+    std::remove(m_FileName.c_str());
+}
+
+bool CSwapJournal::read(const std::string & fileName, const std::string & noteFile, std::vector<TRecord> & records) {
+    records.clear();
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in.is_open())
+        return false;
+    std::stringstream content;
+    content << in.rdbuf();
+    std::string data = content.str();
+
+    std::string head = header(noteFile);
+    if (data.compare(0, head.size(), head) != 0) // journal belongs to different version of the note
+        return false;
+
+    size_t pos = head.size();
+    while (pos < data.size()) {
+        TRecord record{data[pos] == 'I', 0, 0, ""};
+        if (data[pos] != 'I' && data[pos] != 'E')
+            break;
+        ++pos;
+        if (!readNumber(data, pos, record.pos) || !readNumber(data, pos, record.len))
+            break;
+        if (record.insert) {
+            if (data.size() - pos < record.len)
+                break;
+            record.text = data.substr(pos, record.len);
+            pos += record.len;
+        }
+        records.push_back(record);
+    }
+    return !records.empty();
+}
+
+std::string CSwapJournal::header(const std::string & noteFile) {
+    std::string head(m_Magic, sizeof(m_Magic));
+    struct stat info;
+    if (!noteFile.empty() && stat(noteFile.c_str(), &info) == 0) {
+        writeNumber(info.st_size, head);
+        writeNumber(info.st_mtim.tv_sec, head);
+        writeNumber(info.st_mtim.tv_nsec, head);
+    }
+    else
+        head += '\0'; // note does not exist yet
+    return head;
+}
+
+void CSwapJournal::writeNumber(size_t number, std::string & out) {
+    // 7 bits per byte, highest bit tells that number continues, so small numbers take one byte
+    while (number >= 0x80) {
+        out += (char) ((number & 0x7F) | 0x80);
+        number >>= 7;
+    }
+    out += (char) number;
+}
+
+bool CSwapJournal::readNumber(const std::string & data, size_t & pos, size_t & number) {
+    number = 0;
+    for (unsigned int shift = 0; pos < data.size() && shift < 64; shift += 7) {
+        unsigned char byte = data[pos++];
+        number |= (size_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
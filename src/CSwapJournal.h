@@ -0,0 +1,99 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * Append-only journal of changes of an opened note (similar to vim's swap file). Every change of text is appended as
+ * small binary record, records are written to the file in groups. If the editor crashes, changes can be replayed onto
+ * the note stored on the disk. Journal header identifies the note (size and time of modification), so journal of
+ * different version of the note is never replayed.
+ */
+class CSwapJournal {
+public:
+    struct TRecord {
+        bool insert; // true for insertion, false for erasure
+        size_t pos; // position in the buffer
+        size_t len; // length of erased text (for insertion length of text)
+        std::string text; // inserted text (empty for erasure)
+    };
+
+    /**
+     * Creates new journal (previous journal in the file is discarded).
+     * @param[in] fileName File of the journal.
+     * @param[in] noteFile File of the note, to which journal belongs ("" if note has not been saved yet).
+     */
+    CSwapJournal(const std::string & fileName, const std::string & noteFile);
+
+    /**
+     * Writes buffered records and closes the journal (file is kept).
+     */
+    ~CSwapJournal();
+    CSwapJournal(const CSwapJournal &) = delete;
+    CSwapJournal & operator = (const CSwapJournal &) = delete;
+
+    /**
+     * Appends insertion of text to the journal.
+     * @param[in] pos Position where text has been inserted.
+     * @param[in] text Inserted text.
+     */
+    void recordInsert(size_t pos, const std::string & text);
+
+    /**
+     * Appends erasure of text to the journal.
+     * @param[in] pos Position of erased text.
+     * @param[in] len Length of erased text.
+     */
+    void recordErase(size_t pos, size_t len);
+
+    /**
+     * Writes buffered records to the file.
+     * @param[in] force If false, records are written only if m_FlushInterval has passed since last write or if there
+     * is more than m_FlushSize of them.
+     */
+    void flush(bool force);
+
+    /**
+     * Closes the journal and deletes it's file.
+     */
+    void remove();
+
+    /**
+     * Reads records from given journal.
+     * @param[in] fileName File of the journal.
+     * @param[in] noteFile File of the note, to which journal should belong.
+     * @param[out] records Records from the journal (incomplete record at the end is ignored).
+     * @return True if journal exists, belongs to given note and contains at least one record.
+     */
+    static bool read(const std::string & fileName, const std::string & noteFile, std::vector<TRecord> & records);
+
+private:
+    static const size_t m_FlushSize = 4096;
+    static const int m_FlushInterval = 500; // in ms
+    static const char m_Magic[8];
+
+    std::string m_FileName;
+    int m_Fd; // -1 if journal could not be created
+    std::string m_Buffer; // records, that have not been written yet
+    std::chrono::steady_clock::time_point m_LastFlush;
+
+    /**
+     * Creates header identifying given note.
+     */
+    static std::string header(const std::string & noteFile);
+
+    static void writeNumber(size_t number, std::string & out);
+
+    /**
+     * Reads number written by writeNumber().
+     * @param[in, out] pos Position of the number in data, will be moved after the number.
+     * @return False if data end before the number.
+     */
+    static bool readNumber(const std::string & data, size_t & pos, size_t & number);
+};
@@ -5,7 +5,13 @@
 
 #include "CText.h"
 
-void CText::setFormat(const CTextStorage & storage, CWindow & ediotorWin) const {}
+unsigned char CText::nextState(CTextStorage::TLineView text, unsigned char state) const {
+    return 0;
+}
+
+void CText::lineSpans(CTextStorage::TLineView text, unsigned char state, std::vector<TSpan> & spans) const {
+    spans.clear();
+}
 
 std::string CText::getFileExt() const {
     return ".txt";
@@ -18,7 +18,8 @@ public:
     CText(const CText &) = delete;
     CText & operator = (const CText &) = delete;
 
-    void setFormat(const CTextStorage & storage, CWindow & ediotorWin) const override;
+    unsigned char nextState(CTextStorage::TLineView text, unsigned char state) const override;
+    void lineSpans(CTextStorage::TLineView text, unsigned char state, std::vector<TSpan> & spans) const override;
     std::string getFileExt() const override;
     bool needsColor() const override;
 };
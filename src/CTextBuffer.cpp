@@ -0,0 +1,17 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CTextBuffer.h"
+
+size_t CTextBuffer::lineEnd(size_t line) const {
+    if (line + 1 >= lineCount())
+        return size();
+    return lineStart(line + 1) - 1; // -1 for '\n'
+}
+
+void CTextBuffer::getLine(size_t line, std::string & out) const {
+    size_t start = lineStart(line);
+    read(start, lineEnd(line) - start, out);
+}
@@ -0,0 +1,103 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Abstract representation of raw text stored in CTextStorage. Text is seen as one sequence of UTF-8 encoded bytes, lines
+ * are separated by '\n' (there is no '\n' after the last line, so empty buffer contains exactly one empty line).
+ * All positions are byte offsets counted from 0.
+ */
+class CTextBuffer {
+public:
+    struct TMemoryStats {
+        size_t payload = 0; // bytes of text stored in memory
+        size_t overhead = 0; // bytes used by structures describing the text (including unused capacity)
+        size_t allocations = 0; // number of heap allocations
+        size_t mapped = 0; // bytes of text read directly from memory mapped file (they are not stored in memory)
+    };
+
+    CTextBuffer() = default;
+    virtual ~CTextBuffer() = default;
+    CTextBuffer(const CTextBuffer &) = delete;
+    CTextBuffer & operator = (const CTextBuffer &) = delete;
+
+    /**
+     * @return Number of stored bytes.
+     */
+    virtual size_t size() const = 0;
+
+    /**
+     * @return Number of stored lines (number of '\n' + 1).
+     */
+    virtual size_t lineCount() const = 0;
+
+    /**
+     * @param[in] line Index of line (counted from 0).
+     * @return Position of first byte of given line, size() if line does not exist.
+     */
+    virtual size_t lineStart(size_t line) const = 0;
+
+    /**
+     * Inserts given bytes before given position.
+     * @param[in] pos Position, where text should be inserted (0 - size()).
+     * @param[in] text Bytes to insert.
+     * @param[in] len Number of bytes to insert.
+     */
+    virtual void insert(size_t pos, const char * text, size_t len) = 0;
+
+    /**
+     * Erases given range of bytes. Range is cut off if it reaches behind the end of the buffer.
+     * @param[in] pos Position of first byte to erase.
+     * @param[in] len Number of bytes to erase.
+     */
+    virtual void erase(size_t pos, size_t len) = 0;
+
+    /**
+     * Appends next part of the original file (file given to the constructor of buffer) to the end of the buffer. Appended
+     * text is not copied. Parts must be appended in order in which they are in the file.
+     * @param[in] len Number of bytes to append.
+     * @param[in] breaks Positions of all '\n' in appended part (counted from the beginning of the original file).
+     */
+    virtual void appendOriginal(size_t len, const std::vector<size_t> & breaks) = 0;
+
+    /**
+     * Copies given range of bytes to out (previous content of out is replaced).
+     * @param[in] pos Position of first byte to copy.
+     * @param[in] len Number of bytes to copy.
+     * @param[out] out String to which bytes will be copied.
+     */
+    virtual void read(size_t pos, size_t len, std::string & out) const = 0;
+
+    /**
+     * Creates immutable copy of the buffer. Text is not copied, it is shared with the buffer (copy-on-write), so creating
+     * a snapshot is cheap. Snapshot can be read by another thread, while the buffer is being changed.
+     * @return Snapshot of the buffer.
+     */
+    virtual std::shared_ptr<const CTextBuffer> snapshot() const = 0;
+
+    /**
+     * Adds memory used by the buffer to given stats.
+     * @param[in, out] stats Memory stats.
+     */
+    virtual void memoryStats(TMemoryStats & stats) const = 0;
+
+    /**
+     * @param[in] line Index of line (counted from 0).
+     * @return Position of '\n' ending given line, or size() for the last line.
+     */
+    size_t lineEnd(size_t line) const;
+
+    /**
+     * Copies bytes of given line (without '\n') to out.
+     * @param[in] line Index of line (counted from 0).
+     * @param[out] out String to which line will be copied.
+     */
+    void getLine(size_t line, std::string & out) const;
+};
@@ -11,14 +11,26 @@
 #include "CText.h"
 #include "CConverter.h"
 #include "CInform.h"
-#include "CUnsupportedInput.h"
+#include "CAtomicFile.h"
 
 #include <ncurses.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
 
 
-CTextEditor::CTextEditor() : m_TxtStor(4), m_ContHght(3), m_EWin(LINES - m_ContHght, COLS, 0, 0, false),
-                                              m_ControlsWindow(m_ContHght, COLS, LINES - m_ContHght, 0, false)
-                                              {}
+const char * const CTextEditor::m_PhaseNames[PhaseCount] = {"input", "render", "refresh", "total"};
+
+CTextEditor::CTextEditor() : m_TxtStor(6), m_ContHght(5), m_EWin(LINES - m_ContHght, COLS, 0, 0, false),
+                                              m_ControlsWindow(m_ContHght, COLS, LINES - m_ContHght, 0, false),
+                                              m_CtrlHome(keyCode("kHOM5")), m_CtrlEnd(keyCode("kEND5")) {
+    m_EWin.setHardwareScroll(true); // scrolled and shifted rows are moved by the terminal
+}
+
+CTextEditor::~CTextEditor() {
+    delete m_LatencyWin;
+}
 
 CNote CTextEditor::run(const CNote & note, const std::string & folder) {
     if (!m_TxtStor.load(folder + '/' + CConverter::toString(note.getName())))
@@ -37,14 +49,26 @@ CNote CTextEditor::run(const CNote & note, const std::string & folder) {
 
 CNote CTextEditor::run(CFormat * format, const std::string & folder) {
     m_Format = format;
+    CHighlighter highlighter(*format); // format is used by background thread, so it has to stop before run() returns
+    if (format -> needsColor() && has_colors() && can_change_color())
+        m_Highlighter = &highlighter;
     printControlWindow();
     checkColors();
+    std::string noteName = m_Note ? CConverter::toString(m_Note -> getName()) : "untitled" + format -> getFileExt();
+    startJournal(folder + "/." + noteName + ".swp", m_Note ? folder + '/' + noteName : "");
     loadFromStorage(); // Does not do anything if new note is being created.
                        // If already existing note is opened, it will print it's content to the scr.
-
-    wint_t input = m_EWin.readWch(); // get_wch (ncurses function) returns wint_t instead of wchar_t, it is probably a bug.
+    printMemoryStats();
+    m_TxtStor.enableAutosave(folder + "/." + noteName + ".autosave");
+    CDisplay::bracketedPaste(true);
+
+    bool key; // true if input is a function key
+    wint_t input = readInput(key); // get_wch (ncurses function) returns wint_t instead of wchar_t, it is probably a bug.
+    bool pending = false; // true if input contains key, that has already been read, but has not been handled yet
+    auto shown = std::chrono::steady_clock::now(); // when the first key, that has not been displayed yet, was read
     while (true) {
-        switch (input) {
+        auto start = std::chrono::steady_clock::now();
+        switch (key || input < KEY_MIN ? input : WEOF) { // char with the same code as a function key is typed text
             case KEY_RIGHT:
             case 560: // ctrl + right
                 rightKeyAction();
@@ -61,6 +85,18 @@ CNote CTextEditor::run(CFormat * format, const std::string & folder) {
             case 525: // ctrl + down
                 downKeyAction();
                 break;
+            case KEY_PPAGE:
+                pageKeyAction(false);
+                break;
+            case KEY_NPAGE: // pgDown
+                pageKeyAction(true);
+                break;
+            case KEY_HOME:
+                moveCursorTo(m_TxtStor.convertScreenY(m_EWin.getCurY()), 0);
+                break;
+            case KEY_END:
+                moveCursorTo(m_TxtStor.convertScreenY(m_EWin.getCurY()), m_TxtStor.endOfCurLine(m_EWin.getCurY()));
+                break;
             case KEY_DC: // Delete ketempCurPosy
                 deleteKeyAction();
                 break;
@@ -78,25 +114,180 @@ CNote CTextEditor::run(CFormat * format, const std::string & folder) {
             case '\t':
                 tabKeyAction();
                 break;
-            case KEY_F(1):
-                if (!m_Note)
-                    return saveNewFile(format -> getFileExt(), folder);
-                return saveExistingFile(folder);
+            case KEY_F(1): {
+                CNote note = m_Note ? saveExistingFile(folder) : saveNewFile(format -> getFileExt(), folder);
+                saveLatency(folder + "/.latency.hgrm");
+                m_TxtStor.disableAutosave();
+                m_TxtStor.stopJournal();
+                CDisplay::bracketedPaste(false);
+                return note;
+            }
             case KEY_F(2):
+                saveLatency(folder + "/.latency.hgrm");
+                m_TxtStor.disableAutosave();
+                m_TxtStor.stopJournal();
+                CDisplay::bracketedPaste(false);
                 return CNote(L"/"); // "Null" note (user can not create note with this name)
+            case KEY_F(3):
+                goToLineAction();
+                break;
+            case KEY_F(4):
+                wrapKeyAction();
+                break;
+            case 26: // ctrl + z
+                undoKeyAction(true);
+                break;
+            case 25: // ctrl + y
+                undoKeyAction(false);
+                break;
+            case CDisplay::PasteBegin:
+                pasteAction();
+                break;
+            case KEY_F(12):
+                latencyKeyAction();
+                break;
             default:
-                if (CUnsupportedInput::isSupported(input))
-                    inputKeyAction(input);
+                if (key && (int) input == m_CtrlHome)
+                    moveCursorTo(0, 0);
+                else if (key && (int) input == m_CtrlEnd)
+                    moveCursorTo(m_TxtStor.getNumOfLines() - 1, m_TxtStor.getLastLine().size());
+                else if (isPlainChar(input, key))
+                    pending = inputKeyAction(input, key);
+        }
+        m_Latency[Input].record(microsSince(start));
+        // keys waiting in the input queue (for example pasted text) are handled before the screen is rendered
+        if (pending || m_EWin.tryReadWch(input, 0, key)) {
+            pending = false;
+            continue;
         }
+
+        start = std::chrono::steady_clock::now();
+        render();
+        m_Latency[Render].record(microsSince(start));
+        start = std::chrono::steady_clock::now();
         m_EWin.refreshWindow();
-        input = m_EWin.readWch();
+        printLatency();
+        CWindow::updateScreen(); // input queue is empty, so the screen would be updated before next read anyway
+        m_Latency[Refresh].record(microsSince(start));
+        m_Latency[Total].record(microsSince(shown));
+
+        input = readInput(key);
+        shown = std::chrono::steady_clock::now();
+    }
+}
+
+wint_t CTextEditor::readInput(bool & key) {
+    wint_t input;
+    m_TxtStor.autosave();
+    m_TxtStor.flushJournal(false); // changes are written in groups, not after every key
+    printSaveStats();
+    while (true) {
+        bool formatting = m_Highlighter && m_Highlighter -> pending();
+        if (m_EWin.tryReadWch(input, formatting ? m_FormatTick : m_TickTime, key))
+            return input;
+        if (formatting) { // formatting is shown as soon as it is computed, text has already been shown
+            showFormat();
+            continue;
+        }
+        m_TxtStor.autosave(); // autosave is checked even if user does not type
+        m_TxtStor.flushJournal(true);
+        printSaveStats();
+        printMemoryStats(); // stats are not computed after every key, because of large notes
     }
 }
 
+void CTextEditor::startJournal(const std::string & fileName, const std::string & noteFile) {
+    std::vector<CSwapJournal::TRecord> records;
+    if (CSwapJournal::read(fileName, noteFile, records)) { // editor has not been closed properly last time
+        CInputWindow inputWindow("Unsaved changes found (crash?), recover them? (y/n)");
+        std::wstring answer = inputWindow.run();
+        if (answer != L"y" && answer != L"Y")
+            records.clear();
+    }
+    m_TxtStor.startJournal(fileName, noteFile, records);
+}
+
+void CTextEditor::printSaveStats() {
+    CAtomicFile::TStats stats;
+    size_t saves = CAtomicFile::lastStats(stats);
+    if (saves == m_ShownSaves) // autosave runs in background, so stats are printed when it finishes
+        return;
+    m_ShownSaves = saves;
+
+    std::ostringstream text;
+    text << "saved " << stats.fileName.substr(stats.fileName.find_last_of('/') + 1) << ": " << stats.bytes
+         << " B in " << stats.time.count() / 1000.0 << " ms" << (stats.synced ? " (synced)" : "");
+    m_ControlsWindow.eraseLine(4);
+    m_ControlsWindow.printText(text.str(), 4, 1, A_NORMAL);
+    m_ControlsWindow.refreshWindow();
+    m_EWin.refreshWindow(); // cursor must stay in editor window
+}
+
+void CTextEditor::printMemoryStats() {
+    CTextBuffer::TMemoryStats stats = m_TxtStor.memoryStats();
+    std::string text = "memory: text " + CConverter::toReadableSize(stats.payload) + ", overhead "
+                       + CConverter::toReadableSize(stats.overhead) + " (" + std::to_string(stats.allocations)
+                       + " allocations), mapped " + CConverter::toReadableSize(stats.mapped);
+    m_ControlsWindow.eraseLine(3);
+    m_ControlsWindow.printText(text, 3, 1, A_NORMAL);
+    m_ControlsWindow.refreshWindow();
+    m_EWin.refreshWindow();
+}
+
+void CTextEditor::latencyKeyAction() {
+    if (m_LatencyWin) {
+        delete m_LatencyWin; // window is erased when destroyed
+        m_LatencyWin = nullptr;
+        m_TxtStor.damageAll();
+        return;
+    }
+    m_LatencyUsed = true;
+    m_LatencyWin = new CWindow(PhaseCount + 3, 40, 0, COLS - 40, true);
+    m_LatencyWin -> printText("latency       p50         p99", 1, 1);
+}
+
+void CTextEditor::printLatency() {
+    if (!m_LatencyWin)
+        return;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        std::ostringstream line;
+        line << std::left << std::setw(8) << m_PhaseNames[phase] << std::right
+             << std::setw(9) << m_Latency[phase].percentile(50) << " us"
+             << std::setw(9) << m_Latency[phase].percentile(99) << " us";
+        m_LatencyWin -> eraseLine(phase + 2); // printText inserts chars, old row would be shifted
+        m_LatencyWin -> printText(line.str(), phase + 2, 1);
+    }
+    m_LatencyWin -> redrawBox();
+    m_LatencyWin -> touchWindow(); // editor window may have been painted over it
+    m_LatencyWin -> refreshWindow();
+    m_EWin.refreshWindow(); // cursor must stay in editor window
+}
+
+void CTextEditor::saveLatency(const std::string & fileName) const {
+    if (!m_LatencyUsed)
+        return;
+    std::ostringstream data;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        data << "# " << m_PhaseNames[phase] << " (microseconds)\n";
+        m_Latency[phase].print(data);
+        data << '\n';
+    }
+    CAtomicFile file(fileName);
+    file.write(data.str().data(), data.str().size());
+    file.commit();
+}
+
+uint64_t CTextEditor::microsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
 void CTextEditor::printControlWindow() {
     m_ControlsWindow.printHLine(0);
     m_ControlsWindow.printText("f1 = SAVE & EXIT", 1, 1);
     m_ControlsWindow.printText("f2 = DISCARD & EXIT", 1, 20);
+    m_ControlsWindow.printText("f3 = GO TO LINE", 1, 42);
+    m_ControlsWindow.printText("ctrl+z / ctrl+y = UNDO / REDO", 1, 60);
+    m_ControlsWindow.printText("f4 = SOFT WRAP", 1, 92);
     m_ControlsWindow.printText("write !tags: <tags> on the last line to add tags (separated by spaces)", 2, 1);
     m_ControlsWindow.refreshWindow();
 }
@@ -104,9 +295,13 @@ void CTextEditor::printControlWindow() {
 void CTextEditor::rightKeyAction() {
     if (m_EWin.getCurX() != m_EWin.getWidth() - 1 && m_TxtStor.canMoveRight(m_EWin.getCurY(), m_EWin.getCurX()))
         m_EWin.moveCur(CWindow::EDirection::RIGHT);
+    else if (m_TxtStor.softWrap() && m_TxtStor.canMoveRight(m_EWin.getCurY(), m_EWin.getCurX())) { // next row
+        size_t col = m_TxtStor.convertScreenX(m_EWin.getCurY(), m_EWin.getCurX()) + 1;
+        moveCursorTo(m_TxtStor.convertScreenY(m_EWin.getCurY()), col);
+    }
     else if (m_EWin.getCurX() == m_EWin.getWidth() - 1 && m_TxtStor.canScrollLineRight(m_EWin.getCurY())) {
-        m_TxtStor.scrollRight();
-        redrawScreen();
+        unsigned int col = m_TxtStor.convertScreenX(m_EWin.getCurX()) + 1;
+        m_EWin.moveCur(m_EWin.getCurY(), m_TxtStor.showColumn(col)); // screen jumps, cursor moves with the text
     }
 }
 
@@ -114,8 +309,12 @@ void CTextEditor::leftKeyAction() {
     if (m_EWin.getCurX() > 0)
         m_EWin.moveCur(CWindow::EDirection::LEFT);
     else if (m_TxtStor.canScrollLeft()) {
-       m_TxtStor.scrollLeft();
-       redrawScreen();
+        unsigned int col = m_TxtStor.convertScreenX(0) - 1;
+        m_EWin.moveCur(m_EWin.getCurY(), m_TxtStor.showColumn(col));
+    }
+    else if (m_TxtStor.softWrap() && m_TxtStor.convertScreenX(m_EWin.getCurY(), 0) > 0) { // previous row of the line
+        size_t col = m_TxtStor.convertScreenX(m_EWin.getCurY(), 0) - 1;
+        moveCursorTo(m_TxtStor.convertScreenY(m_EWin.getCurY()), col);
     }
 }
 
@@ -124,8 +323,6 @@ void CTextEditor::upKeyAction() {
     bool redraw;
     if ((x = m_TxtStor.MoveUp(redraw, m_EWin.getCurY(), m_EWin.getCurX())) != -1) { // can move up on curr scr
         m_EWin.moveCur(m_EWin.getCurY() > 0 ? m_EWin.getCurY() - 1 : 0, x);
-        if (redraw)
-            redrawScreen();
     }
 }
 
@@ -134,33 +331,89 @@ void CTextEditor::downKeyAction() {
     bool redraw;
     if ((x = m_TxtStor.MoveDown(redraw, m_EWin.getCurY(), m_EWin.getCurX())) != -1) {
         m_EWin.moveCur(m_EWin.getCurY() < m_EWin.getHeight() - 2 ? m_EWin.getCurY() + 1 : m_EWin.getHeight() - 1, x);
-        if (redraw)
-            redrawScreen();
     }
 }
 
+void CTextEditor::pageKeyAction(bool down) {
+    unsigned int y = m_EWin.getCurY();
+    unsigned int x = m_EWin.getCurX();
+    m_TxtStor.movePage(down, y, x); // scrolled screen is repainted by render()
+    m_EWin.moveCur(y, x);
+}
+
+void CTextEditor::moveCursorTo(size_t line, size_t col) {
+    unsigned int y, x;
+    m_TxtStor.moveTo(line, col, y, x);
+    m_EWin.moveCur(y, x);
+}
+
+void CTextEditor::goToLineAction() {
+    std::wstring input;
+    {
+        CInputWindow inputWindow("Go to line (number or percentage, for example 120 or 50%):");
+        input = inputWindow.run();
+    } // input window is erased when destroyed
+    m_TxtStor.damageAll();
+
+    bool percent = !input.empty() && input.back() == L'%';
+    if (percent)
+        input.pop_back();
+    if (input.empty() || input.size() > 18) // longer number could overflow
+        return;
+    size_t number = 0;
+    for (wchar_t c : input) {
+        if (c < L'0' || c > L'9') // invalid input, cursor stays where it is
+            return;
+        number = number * 10 + (c - L'0');
+    }
+
+    if (percent)
+        moveCursorTo(m_TxtStor.lineAtPercent(number), 0);
+    else
+        moveCursorTo(number > 0 ? number - 1 : 0, 0); // lines are numbered from 1 for the user
+}
+
+void CTextEditor::wrapKeyAction() {
+    size_t line = m_TxtStor.convertScreenY(m_EWin.getCurY());
+    size_t col = m_TxtStor.convertScreenX(m_EWin.getCurY(), m_EWin.getCurX());
+    m_TxtStor.setSoftWrap(!m_TxtStor.softWrap());
+    moveCursorTo(line, col);
+}
+
+void CTextEditor::undoKeyAction(bool undo) {
+    unsigned int y, x;
+    if (undo ? m_TxtStor.undo(y, x) : m_TxtStor.redo(y, x)) // entire group of changes is shown by one render()
+        m_EWin.moveCur(y, x);
+}
+
 void CTextEditor::deleteKeyAction() {
-    m_EWin.deleteCurChar();
     m_TxtStor.delChar(m_EWin.getCurY(), m_EWin.getCurX());
-    m_Format -> setFormat(m_TxtStor, m_EWin);
 }
 
 void CTextEditor::backspaceKeyAction() {
+    if (m_TxtStor.softWrap()) { // cursor may have to move to the previous row, so positions in storage are used
+        size_t line = m_TxtStor.convertScreenY(m_EWin.getCurY());
+        size_t col = m_TxtStor.convertScreenX(m_EWin.getCurY(), m_EWin.getCurX());
+        if (col > 0) {
+            moveCursorTo(line, col - 1);
+            deleteKeyAction();
+        }
+        else if (line > 0) {
+            size_t end = m_TxtStor.endOfPrevLine(m_EWin.getCurY());
+            m_TxtStor.moveLineUp(m_EWin.getCurY()); // join line to line above
+            moveCursorTo(line - 1, end);
+        }
+        return;
+    }
     if (m_EWin.getCurX() == 0 && !m_TxtStor.canScrollLeft()) { // cursor is in first column
         if (m_EWin.getCurY() == 0 && !m_TxtStor.canScrollUp()) // cursor is on first line, and can not move up
             return;
-        m_EWin.deleteCurLine(); // deletes line from screen
         unsigned int end = m_TxtStor.endOfPrevLine(m_EWin.getCurY());
-        const std::wstring & text = m_TxtStor.moveLineUp(m_EWin.getCurY()); // join line to line above
-        if (end >= m_EWin.getWidth()) {
+        m_TxtStor.moveLineUp(m_EWin.getCurY()); // join line to line above
+        if (end >= m_EWin.getWidth())
             m_EWin.moveCur(m_EWin.getCurY() > 0 ? m_EWin.getCurY() - 1 : 0, m_TxtStor.moveScreenToHorPos(end));
-            redrawScreen();
-        }
-        else  {
+        else
             m_EWin.moveCur(m_EWin.getCurY() >= 1 ? m_EWin.getCurY() - 1 : 0, end);
-            m_EWin.replaceLine(m_EWin.getCurY(), text);
-            m_Format -> setFormat(m_TxtStor, m_EWin);
-        }
     }
     else { // cursors is not in first column
         if (m_EWin.getCurX() == 0 && m_TxtStor.canScrollLeft()) { // can move left, but scr must be scrolled
@@ -168,13 +421,17 @@ void CTextEditor::backspaceKeyAction() {
         }
         else
             m_EWin.moveCur(CWindow::EDirection::LEFT);
-        m_EWin.deleteCurChar();
         m_TxtStor.delChar(m_EWin.getCurY(), m_EWin.getCurX());
-        m_Format -> setFormat(m_TxtStor, m_EWin);
     }
 }
 
 void CTextEditor::enterKeyAction() {
+    if (m_TxtStor.softWrap()) {
+        size_t line = m_TxtStor.convertScreenY(m_EWin.getCurY());
+        m_TxtStor.moveEndOfLineDown(m_EWin.getCurY(), m_EWin.getCurX());
+        moveCursorTo(line + 1, 0);
+        return;
+    }
     m_TxtStor.moveEndOfLineDown(m_EWin.getCurY(), m_EWin.getCurX());
     if (m_EWin.getCurY() == (unsigned) m_EWin.getHeight() - 1) { // cursor is at the bottom of the window -> scrl window
         m_TxtStor.scrollDown();
@@ -183,25 +440,76 @@ void CTextEditor::enterKeyAction() {
     else {
         m_EWin.moveCur(m_EWin.getCurY() + 1, 0);
     }
-    redrawScreen();
 }
 
-void CTextEditor::inputKeyAction(wint_t input) {
-    m_EWin.printChar((wchar_t) input, A_NORMAL, 0);
-    m_TxtStor.inputChar((wchar_t) input, m_EWin.getCurY(), m_EWin.getCurX());
-    if (m_EWin.getCurX() == m_EWin.getWidth() - 1) {
-        rightKeyAction();
+bool CTextEditor::inputKeyAction(wint_t & input, bool & key) {
+    std::wstring text(1, (wchar_t) input);
+    bool pending = false;
+    while (m_EWin.tryReadWch(input, 0, key)) { // chars that are already waiting are inserted together
+        pending = !isPlainChar(input, key);
+        if (pending)
+            break;
+        text += (wchar_t) input;
     }
-    m_EWin.moveCur(CWindow::EDirection::RIGHT);
-    m_Format -> setFormat(m_TxtStor, m_EWin);
+    inputText(text);
+    return pending;
 }
 
-void CTextEditor::tabKeyAction() {
-    for (int i = 0; i < 4; i++) {
-        m_EWin.printChar(' ');
-        m_TxtStor.inputChar(' ', m_EWin.getCurY(), m_EWin.getCurX());
-        m_EWin.moveCur(CWindow::EDirection::RIGHT);
+void CTextEditor::inputText(const std::wstring & text) {
+    if (m_TxtStor.softWrap()) { // text continues on the next row
+        size_t line = m_TxtStor.convertScreenY(m_EWin.getCurY());
+        size_t col = m_TxtStor.convertScreenX(m_EWin.getCurY(), m_EWin.getCurX());
+        m_TxtStor.inputText(text, m_EWin.getCurY(), m_EWin.getCurX());
+        moveCursorTo(line, col + text.size());
+        return;
     }
+    unsigned int y = m_EWin.getCurY();
+    unsigned int x = m_EWin.getCurX() + text.size();
+    m_TxtStor.inputText(text, y, m_EWin.getCurX());
+    if (x >= m_EWin.getWidth()) // cursor would leave the window, screen jumps instead
+        x = m_TxtStor.showColumn(m_TxtStor.convertScreenX(x));
+    m_EWin.moveCur(y, x);
+}
+
+void CTextEditor::pasteAction() {
+    std::wstring text;
+    wint_t input;
+    bool key;
+    bool cr = false; // last char was '\r'
+    // entire pasted text is already waiting, timeout only prevents waiting forever if the end of paste gets lost
+    while (m_EWin.tryReadWch(input, m_TickTime, key) && !(key && input == CDisplay::PasteEnd)) {
+        if (input == L'\n' && cr) { // "\r\n" is one newline
+            cr = false;
+            continue;
+        }
+        cr = input == L'\r';
+        if (cr || input == L'\n' || (key && input == KEY_ENTER))
+            text += L'\n';
+        else if (input == L'\t')
+            text += L"    "; // same as tab key
+        else if (isPlainChar(input, key))
+            text += (wchar_t) input;
+    }
+
+    unsigned int y = m_EWin.getCurY();
+    unsigned int x = m_EWin.getCurX();
+    m_TxtStor.pasteText(text, y, x);
+    m_EWin.moveCur(y, x);
+}
+
+void CTextEditor::tabKeyAction() {
+    inputText(L"    ");
+}
+
+bool CTextEditor::isPlainChar(wint_t input, bool key) {
+    return !key && input >= L' ' && input != 127; // function keys and control chars are handled by run()
+}
+
+int CTextEditor::keyCode(const char * capability) {
+    char * sequence = tigetstr(capability);
+    if (!sequence || sequence == (char *) -1) // terminal does not have the key
+        return 0;
+    return std::max(key_defined(sequence), 0); // -1 means, that sequence is only a prefix of other keys
 }
 
 CNote CTextEditor::saveNewFile(const std::string & fileExt, const std::string & folder) {
@@ -261,11 +569,82 @@ void CTextEditor::controlsForSaving() {
 }
 
 void CTextEditor::redrawScreen() {
-    m_EWin.eraseWindow();
-    int i = 0;
-    for (const auto & line : m_TxtStor.getWindow())
-        m_EWin.printText(line, i++, 0);
-    m_Format -> setFormat(m_TxtStor, m_EWin);
+    m_TxtStor.damageAll();
+    render();
+}
+
+void CTextEditor::render() {
+    CTextStorage::TScroll scroll;
+    if (m_TxtStor.takeScroll(scroll))
+        scrollWindow(scroll);
+    unsigned int from, to;
+    if (m_TxtStor.takeDamage(from, to))
+        repaint(from, to);
+    requestFormat();
+}
+
+void CTextEditor::scrollWindow(const CTextStorage::TScroll & scroll) {
+    if (scroll.offset != 0)
+        m_EWin.scr(scroll.offset > 0 ? CWindow::EDirection::DOWN : CWindow::EDirection::UP, std::abs(scroll.offset));
+    if (scroll.count != 0)
+        m_EWin.shiftRows(scroll.row, scroll.count);
+
+    // rows, that have not been moved from another row, are blank now
+    int height = m_EWin.getHeight();
+    int first = -1; // first row of the current run of blank rows
+    for (int y = 0; y <= height; ++y) {
+        int source = y; // row, from which row y has been moved
+        if (y >= (int) scroll.row && scroll.count != 0)
+            source = y < (int) scroll.row + scroll.count ? -1 : y - scroll.count; // inserted rows have no source
+        source = source < 0 || source >= height ? -1 : source + scroll.offset;
+        bool blank = y < height && (source < 0 || source >= height);
+        if (blank && first < 0)
+            first = y;
+        else if (!blank && first >= 0) {
+            repaint(first, y);
+            first = -1;
+        }
+    }
+}
+
+void CTextEditor::repaint(unsigned int from, unsigned int to) {
+    m_TxtStor.visitScreenLines(from, to, [this](unsigned int y, CTextStorage::TLineView line) {
+        m_EWin.replaceLine(y, line.text, line.len);
+    });
+    format(from, to); // lines formatted in advance (for example scrolled to) are formatted right away
+}
+
+void CTextEditor::format(unsigned int from, unsigned int to) {
+    if (!m_Highlighter)
+        return;
+    size_t revision = m_TxtStor.revision();
+    for (unsigned int y = from; y < to; ++y) {
+        const std::vector<CFormat::TSpan> * spans = m_Highlighter -> spans(m_TxtStor.convertScreenY(y), revision);
+        if (spans)
+            CFormat::applySpans(m_TxtStor, m_EWin, y, *spans);
+    }
+}
+
+void CTextEditor::requestFormat() {
+    if (!m_Highlighter)
+        return;
+    size_t first = m_TxtStor.convertScreenY(0);
+    if (m_TxtStor.revision() == m_RequestedRevision && first == m_RequestedLine)
+        return;
+    m_RequestedRevision = m_TxtStor.revision();
+    m_RequestedLine = first;
+    size_t last = m_TxtStor.convertScreenY(m_EWin.getHeight() - 1);
+    m_TxtStor.takeSplices(m_Splices);
+    m_Highlighter -> request(m_TxtStor.snapshot(last + CHighlighter::m_Margin), m_RequestedRevision, m_Splices, first,
+                             last);
+}
+
+void CTextEditor::showFormat() {
+    if (!m_Highlighter -> update())
+        return;
+    format(0, m_EWin.getHeight()); // state of lines below a change (for example opened code block) may have changed
+    m_EWin.refreshWindow();
+    printLatency();
 }
 
 void CTextEditor::checkColors() {
@@ -11,6 +11,10 @@
 #include "CWindow.h"
 #include "CNoteStorage.h"
 #include "CText.h"
+#include "CHistogram.h"
+#include "CHighlighter.h"
+
+#include <chrono>
 
 /**
  * Basic text editor. Createing
@@ -18,7 +22,7 @@
 class CTextEditor {
 public:
     CTextEditor();
-    ~CTextEditor() = default;
+    ~CTextEditor();
     CTextEditor(const CTextEditor &) = delete;
     CTextEditor & operator = (const CTextEditor &) = delete;
 
@@ -45,6 +49,77 @@ private:
     CWindow m_ControlsWindow;
     const CNote * m_Note = nullptr; // stores pointer to existing note, when already created note is opened (will be used read-only)
     CFormat * m_Format = nullptr;
+    CHighlighter * m_Highlighter = nullptr; // computes formatting in background (nullptr if formatting is turned off)
+    size_t m_RequestedRevision = CHighlighter::m_NoRevision; // revision of text of the last formatting request
+    size_t m_RequestedLine = 0; // first displayed line of the last formatting request
+    std::vector<CLineStates::TSplice> m_Splices; // reused by requestFormat()
+    static const int m_TickTime = 1000; // how often (in ms) editor wakes up, when there is no input
+    static const int m_FormatTick = 2; // how often (in ms) editor checks, whether formatting has been computed
+    size_t m_ShownSaves = 0; // number of saved files, when save stats have been printed last time
+    int m_CtrlHome; // codes of ctrl + home and ctrl + end differ between terminals (0 if terminal does not have them)
+    int m_CtrlEnd;
+
+    /**
+     * Phases of handling user input, that are measured. Latencies are in microseconds.
+     */
+    enum EPhase {
+        Input = 0, // from reading of the key to the end of it's action (change of storage)
+        Render, // repainting of damaged rows, including their formatting
+        Refresh, // sending of the changes to the terminal
+        Total, // from reading of the first key, that has not been displayed, to the end of refresh
+        PhaseCount
+    };
+    static const char * const m_PhaseNames[PhaseCount];
+    CHistogram m_Latency[PhaseCount];
+    CWindow * m_LatencyWin = nullptr; // overlay with latency percentiles (nullptr if it is hidden)
+    bool m_LatencyUsed = false; // true if overlay has been shown at least once (histograms are saved only then)
+
+    /**
+     * Reads next input from user, autosaving the text while waiting for it.
+     * @param[out] key True if input is a function key, false if it is a char.
+     * @return Input from user.
+     */
+    wint_t readInput(bool & key);
+
+    /**
+     * Starts swap journal of the note. If journal of previous (crashed) session exists, user is asked, whether it
+     * should be replayed.
+     * @param[in] fileName File of the journal.
+     * @param[in] noteFile File of the note ("" if it is a new note).
+     */
+    void startJournal(const std::string & fileName, const std::string & noteFile);
+
+    /**
+     * Prints statistics of the last saved file to the controls window (if some file has been saved since the last call).
+     */
+    void printSaveStats();
+
+    /**
+     * Prints memory used by the note to the controls window.
+     */
+    void printMemoryStats();
+
+    /**
+     * Shows or hides overlay with latency percentiles (hidden key F12).
+     */
+    void latencyKeyAction();
+
+    /**
+     * Prints latency (and allocation) percentiles to the overlay (if it is shown).
+     */
+    void printLatency();
+
+    /**
+     * Writes latency histograms of all phases to given file (overwriting it), if the overlay has been shown (see
+     * latencyKeyAction()). Otherwise nothing is written, so that notes folder is not changed by normal editing.
+     * @param[in] fileName Name of the file.
+     */
+    void saveLatency(const std::string & fileName) const;
+
+    /**
+     * @return Microseconds elapsed since given time.
+     */
+    static uint64_t microsSince(std::chrono::steady_clock::time_point start);
 
     /**
      * Displays control window.
@@ -54,15 +129,73 @@ private:
     void leftKeyAction();
     void upKeyAction();
     void downKeyAction();
+
+    /**
+     * Scrolls editor by one page.
+     * @param[in] down True for page down, false for page up.
+     */
+    void pageKeyAction(bool down);
+
+    /**
+     * Moves cursor to given position in storage (redraws screen if it has to be scrolled).
+     * @param[in] line Index of line in storage.
+     * @param[in] col Index of char on given line.
+     */
+    void moveCursorTo(size_t line, size_t col);
+
+    /**
+     * Turns soft wrap mode on or off (see CTextStorage::setSoftWrap()), cursor stays on the same char.
+     */
+    void wrapKeyAction();
+
+    /**
+     * Undoes or redoes last change.
+     * @param[in] undo True for undo, false for redo.
+     */
+    void undoKeyAction(bool undo);
+
+    /**
+     * Asks user for line number (or percentage of the text) and moves cursor there.
+     */
+    void goToLineAction();
     void deleteKeyAction();
     void backspaceKeyAction();
     void enterKeyAction();
 
     /**
-     * Action for any input key (letter, number,...)
+     * Action for any input key (letter, number,...). Chars waiting in the input queue are inserted together with it.
+     * @param[in,out] input Typed char. If reading of waiting chars stops at a key, that is not a plain char, this key is
+     * stored here.
+     * @param[out] key True if key stored in input is a function key.
+     * @return True if input contains key, that has not been handled yet.
+     */
+    bool inputKeyAction(wint_t & input, bool & key);
+
+    /**
+     * Inserts given text at cursor position and moves cursor behind it.
+     * @param[in] text Text without newlines.
      */
-    void inputKeyAction(wint_t input);
+    void inputText(const std::wstring & text);
     void tabKeyAction();
+
+    /**
+     * Reads text pasted by terminal in bracketed paste mode (until CDisplay::PasteEnd) and inserts it at once. Newlines are
+     * converted to '\n', tabs are expanded the same way as by tab key.
+     */
+    void pasteAction();
+
+    /**
+     * @param[in] input Input from user.
+     * @param[in] key True if input is a function key (see CWindow::tryReadWch()).
+     * @return True if given input is a char, that is simply inserted to the text (not a function or control key).
+     */
+    static bool isPlainChar(wint_t input, bool key);
+
+    /**
+     * @param[in] capability Name of terminfo capability of a key (for example "kEND5" for ctrl + end).
+     * @return Code returned by ncurses for the key (0 if terminal does not have the key).
+     */
+    static int keyCode(const char * capability);
     CNote saveNewFile(const std::string & fileExt, const std::string & folder);
     CNote saveExistingFile(const std::string & folder);
 
@@ -81,6 +214,45 @@ private:
      */
     void redrawScreen();
 
+    /**
+     * Repaints rows of the editor window, that have been damaged since the last render (see CTextStorage::takeDamage()).
+     * Rows, that have only moved, are moved by the terminal (see scrollWindow()). Actions only change storage and move
+     * cursor, text is printed by this method. Formatting of changed text is computed in background, rows are formatted
+     * when it arrives (see showFormat()).
+     */
+    void render();
+
+    /**
+     * Moves rows of the editor window as returned by CTextStorage::takeScroll() and repaints rows, that are left blank.
+     * @param[in] scroll Movement of rows.
+     */
+    void scrollWindow(const CTextStorage::TScroll & scroll);
+
+    /**
+     * Repaints given rows of the editor window from storage, together with their formatting (if it has been computed).
+     * @param[in] from First row.
+     * @param[in] to Row after the last row.
+     */
+    void repaint(unsigned int from, unsigned int to);
+
+    /**
+     * Formats given rows of the editor window by formatting taken from m_Highlighter. Rows, whose formatting has not
+     * been computed for the current text, are not changed.
+     * @param[in] from First row.
+     * @param[in] to Row after the last row.
+     */
+    void format(unsigned int from, unsigned int to);
+
+    /**
+     * Asks m_Highlighter to format displayed lines, if text or displayed lines have changed since the last request.
+     */
+    void requestFormat();
+
+    /**
+     * Formats the editor window by formatting, that has been computed since the last call (if any).
+     */
+    void showFormat();
+
     static void checkColors();
 };
 
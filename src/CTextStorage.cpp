@@ -5,78 +5,124 @@
 
 #include "CTextStorage.h"
 #include "CConverter.h"
+#include "CAtomicFile.h"
 #include "CFile.h"
+#include "CLoader.h"
+#include "CMappedFile.h"
+#include "CPieceTable.h"
+#include "CRope.h"
 
 #include <ncurses.h>
-#include <fstream>
+#include <algorithm>
+#include <memory>
 
+unsigned int CTextStorage::m_HorStep = 0;
 
-CTextStorage::CTextStorage(int yDif, int xDif) : m_YDif(yDif), m_XDif(xDif), m_YOffset(0), m_XOffset(0) {
-    m_Storage.emplace_back(); // initializing first line
+CTextStorage::CTextStorage(int yDif, int xDif) : m_Buffer(new CPieceTable()), m_YDif(yDif), m_XDif(xDif), m_YOffset(0),
+                                                 m_XOffset(0), m_Loader(nullptr),
+                                                 m_CachedLine(m_NoLine), m_Revision(0), m_Autosave(nullptr),
+                                                 m_AutosaveRevision(0), m_Journal(nullptr), m_DamageFrom(0),
+                                                 m_DamageTo(m_NoLine), m_ShownYOffset(0), m_ShownXOffset(0),
+                                                 m_ShiftRow(m_NoLine), m_ShiftLine(0), m_Shift(0), m_Wrap(false) {
     updateSize();
 }
 
+CTextStorage::~CTextStorage() {
+    delete m_Journal;
+    delete m_Autosave;
+    delete m_Loader;
+    delete m_Buffer;
+}
+
 
 void CTextStorage::inputChar(wchar_t c, unsigned int curY, unsigned int curX) {
-    updateSize();
-    unsigned int line = m_YOffset + curY;
-    unsigned int col = m_XOffset + curX;
+    inputText(std::wstring(1, c), curY, curX);
+}
 
-    if (line >= m_Storage.size())
-        m_Storage.emplace_back(1, c);
-    else if (col <= m_Storage[line].size())
-        m_Storage[line].insert(col, 1, c);
-    else
-        m_Storage[line] += c;
+void CTextStorage::inputText(const std::wstring & text, unsigned int curY, unsigned int curX) {
+    insertAtCursor(text, curY, curX);
+}
+
+void CTextStorage::pasteText(const std::wstring & text, unsigned int & curY, unsigned int & curX) {
+    beginUndoGroup(); // group separates pasted text from typing around it
+    size_t end = insertAtCursor(text, curY, curX);
+    endUndoGroup();
+
+    size_t line, col;
+    storagePos(end, line, col);
+    moveTo(line, col, curY, curX);
 }
 
 void CTextStorage::delChar(unsigned int curY, unsigned int curX) {
     updateSize();
-    m_Storage[m_YOffset + curY].erase(m_XOffset + curX, 1);
+    size_t line = lineAt(curY);
+    size_t col = colAt(curY, curX);
+    if (line >= availableLines(line) || col >= lineLength(line))
+        return;
+
+    size_t pos = bufferPos(line, col);
+    eraseText(pos, bufferPos(line, col + 1) - pos);
 }
 
 void CTextStorage::insertLine(unsigned int y) {
-    if (m_YOffset + y <= m_Storage.size())
-        m_Storage.emplace(m_Storage.begin() + y + m_YOffset); // emplace requires iterator
+    size_t line = lineAt(y);
+    if (line < availableLines(line))
+        insertText(m_Buffer -> lineStart(line), "\n"); // current line is moved down
     else
-        m_Storage.emplace_back();
+        insertText(m_Buffer -> size(), "\n");
 }
 
 void CTextStorage::deleteLine(unsigned int y) {
-    m_Storage.erase(m_Storage.begin() + y + m_YOffset); // erase requires iterator
-}
-
-const std::wstring & CTextStorage::scrollUp() {
+    size_t line = lineAt(y);
+    size_t count = availableLines(line + 1);
+    if (line >= count)
+        return;
+    if (line + 1 < count) // line and it's '\n' is erased
+        eraseText(m_Buffer -> lineStart(line), m_Buffer -> lineStart(line + 1) - m_Buffer -> lineStart(line));
+    else if (line > 0) // last line is erased together with '\n' before it
+        eraseText(m_Buffer -> lineStart(line) - 1, m_Buffer -> size() - m_Buffer -> lineStart(line) + 1);
+    else // the only line can not be removed, it is only emptied
+        eraseText(0, m_Buffer -> size());
+}
+
+std::wstring CTextStorage::scrollUp() {
     updateSize();
     m_YOffset -= 1;
-    return m_Storage[m_YOffset];
+    return lineText(lineAt(0));
 }
 
-const std::wstring & CTextStorage::scrollDown() {
+std::wstring CTextStorage::scrollDown() {
     updateSize();
     m_YOffset += 1;
-    if (m_Lines + m_YOffset < m_Storage.size())
-        return m_Storage[m_Lines + m_YOffset];
-    return m_Storage.back();
+    size_t line = lineAt(m_Lines);
+    if (line < availableLines(line))
+        return lineText(line);
+    return getLastLine();
 }
 
 void CTextStorage::updateSize() const {
     m_Lines = LINES - m_YDif;
     m_Cols = COLS - m_XDif;
+    m_Layout.setWidth(m_Cols); // layout is rebuilt, if the width has changed
 }
 
 bool CTextStorage::canMoveRight(unsigned int curY, unsigned int curX) const {
     updateSize();
-    return (curX + m_XOffset < m_Storage[m_YOffset + curY].length());
+    size_t line = lineAt(curY);
+    if (line >= availableLines(line))
+        return false;
+    return colAt(curY, curX) < lineLength(line);
 }
 
 int CTextStorage::MoveUp(bool & redraw, unsigned int curY, unsigned int curX) {
     updateSize();
     redraw = false;
+    if (m_Wrap)
+        return wrapMove(redraw, true, curY, curX);
     if (curY == 0 && !canScrollUp())  // Cursor can not move up (window must be scrolled first)
         return -1;
 
-    unsigned int size = m_Storage[m_YOffset + curY - 1].size();
+    unsigned int size = lineLength(m_YOffset + curY - 1);
 
     if (curY == 0 && canScrollUp()) {
         --m_YOffset;
@@ -88,10 +134,12 @@ int CTextStorage::MoveUp(bool & redraw, unsigned int curY, unsigned int curX) {
 int CTextStorage::MoveDown(bool & redraw, unsigned int curY, unsigned int curX) {
     updateSize();
     redraw = false;
-    if ((curY == m_Lines && !canScrollDown(false)) || m_YOffset + curY + 1 >= m_Storage.size())
+    if (m_Wrap)
+        return wrapMove(redraw, false, curY, curX);
+    if ((curY == m_Lines && !canScrollDown(false)) || m_YOffset + curY + 1 >= availableLines(m_YOffset + curY + 1))
         return -1;
 
-    unsigned int size = m_Storage[m_YOffset + curY + 1].size();
+    unsigned int size = lineLength(m_YOffset + curY + 1);
 
     if (curY == m_Lines && canScrollDown(false)) {
         ++m_YOffset;
@@ -100,6 +148,109 @@ int CTextStorage::MoveDown(bool & redraw, unsigned int curY, unsigned int curX)
     return calculateLinePos(redraw, size, curX);
 }
 
+bool CTextStorage::moveTo(size_t line, size_t col, unsigned int & curY, unsigned int & curX) {
+    updateSize();
+    size_t count = availableLines(line);
+    if (line >= count)
+        line = count - 1;
+    size_t size = lineLength(line);
+    if (col > size)
+        col = size;
+
+    bool redraw = false;
+    if (m_Wrap) { // screen scrolls by rows, never horizontally
+        size_t row = rowOf(line, col);
+        if (row < m_YOffset || row > m_YOffset + m_Lines) {
+            m_YOffset = row < m_YOffset ? row : row - m_Lines;
+            redraw = true;
+        }
+        curY = row - m_YOffset;
+        curX = col % m_Cols;
+        return redraw;
+    }
+    if (line < m_YOffset || line > m_YOffset + m_Lines) {
+        m_YOffset = line < m_YOffset ? line : line - m_Lines;
+        redraw = true;
+    }
+    if (col < m_XOffset || col >= m_XOffset + m_Cols) {
+        m_XOffset = col >= m_Cols / 2 ? col - m_Cols / 2 : 0;
+        redraw = true;
+    }
+    curY = line - m_YOffset;
+    curX = col - m_XOffset;
+    return redraw;
+}
+
+bool CTextStorage::movePage(bool down, unsigned int & curY, unsigned int & curX) {
+    updateSize();
+    size_t page = m_Lines + 1;
+    size_t line = m_YOffset + curY;
+    size_t col = m_XOffset + curX;
+    unsigned int offset = m_YOffset;
+
+    if (m_Wrap) { // the same as below, but with rows instead of lines
+        size_t total = m_Layout.totalRows();
+        size_t row = m_YOffset + curY;
+        if (down) {
+            size_t last = total > page ? total - page : 0;
+            m_YOffset = std::max<size_t>(m_YOffset, std::min(m_YOffset + page, last));
+            row = std::min(row + page, total - 1);
+        }
+        else {
+            m_YOffset = m_YOffset > page ? m_YOffset - page : 0;
+            row = row > page ? row - page : 0;
+        }
+        size_t first;
+        line = m_Layout.lineOfRow(row, first);
+        col = (row - first) * m_Cols + curX;
+    }
+    else if (down) {
+        size_t count = availableLines(m_YOffset + 2 * page);
+        size_t last = count > page ? count - page : 0; // offset, at which last line is at the bottom of the screen
+        m_YOffset = std::max<size_t>(m_YOffset, std::min(m_YOffset + page, last));
+        line = std::min(line + page, count - 1);
+    }
+    else {
+        m_YOffset = m_YOffset > page ? m_YOffset - page : 0;
+        line = line > page ? line - page : 0;
+    }
+    bool redraw = moveTo(line, col, curY, curX);
+    return redraw || offset != m_YOffset;
+}
+
+size_t CTextStorage::lineAtPercent(unsigned int percent) const {
+    size_t last = availableLines(m_NoLine) - 1;
+    return percent >= 100 ? last : last * percent / 100;
+}
+
+bool CTextStorage::undo(unsigned int & curY, unsigned int & curX) {
+    std::vector<CUndoLog::TChange> changes;
+    if (!m_Undo.undo(changes))
+        return false;
+    applyChanges(changes, curY, curX);
+    return true;
+}
+
+bool CTextStorage::redo(unsigned int & curY, unsigned int & curX) {
+    std::vector<CUndoLog::TChange> changes;
+    if (!m_Undo.redo(changes))
+        return false;
+    applyChanges(changes, curY, curX);
+    return true;
+}
+
+void CTextStorage::beginUndoGroup() {
+    m_Undo.beginGroup();
+}
+
+void CTextStorage::endUndoGroup() {
+    m_Undo.endGroup();
+}
+
+void CTextStorage::setUndoLimit(size_t limit) {
+    m_Undo.setLimit(limit);
+}
+
 bool CTextStorage::canScrollUp() const {
     updateSize();
     return m_YOffset; // if offset is 0, we can not move up (because first line is already dispalyed)
@@ -107,46 +258,65 @@ bool CTextStorage::canScrollUp() const {
 
 bool CTextStorage::canScrollDown(bool newLine) const {
     updateSize();
-    return m_Storage.size() > m_YOffset + m_Lines + 1; // +1 because new line would be added (screen would scroll)
+    if (m_Wrap)
+        return m_Layout.totalRows() > m_YOffset + m_Lines + 1;
+    return availableLines(m_YOffset + m_Lines + 1) > m_YOffset + m_Lines + 1; // +1 because new line would be added (screen would scroll)
 }
 
 std::wstring CTextStorage::moveLineUp(unsigned int curY) {
     if (curY == 0 && !canScrollUp())
         throw std::logic_error("Can not move line UP, because there is no line above");
 
-    m_Storage[m_YOffset + curY - 1] += m_Storage[m_YOffset + curY]; // segfault is prevented in previous if
-    m_Storage.erase(m_Storage.begin() + m_YOffset + curY);
+    size_t line = lineAt(curY);
+    eraseText(m_Buffer -> lineStart(line) - 1, 1); // erasing '\n' joins line with the one above
 
-    if (curY == 0)
-        return m_Storage[m_YOffset-- + curY - 1];
-    return m_Storage[m_YOffset + curY - 1];
+    if (curY == 0 && !m_Wrap) // in soft wrap mode editor moves the cursor (and screen) by moveTo()
+        --m_YOffset;
+    return lineText(line - 1);
 }
 
-const std::wstring & CTextStorage::moveEndOfLineDown(unsigned int curY, unsigned int curX) {
-    insertLine(curY + 1);
-
-    auto & curLine = m_Storage[m_YOffset + curY];
-    auto & nextLine = m_Storage[m_YOffset + curY + 1];
+std::wstring CTextStorage::moveEndOfLineDown(unsigned int curY, unsigned int curX) {
+    size_t line = lineAt(curY);
+    if (line < availableLines(line + 1))
+        insertText(bufferPos(line, colAt(curY, curX)), "\n"); // end of line will be on the new line
+    else
+        insertText(m_Buffer -> size(), "\n");
 
-    nextLine = curLine.substr(m_XOffset + curX);
-    curLine.erase(curLine.begin() + curX + m_XOffset, curLine.end());
     m_XOffset = 0; // screen will be moved to the left in CTextEditor
-    return nextLine;
+    return lineText(line + 1);
 }
 
 unsigned int CTextStorage::endOfCurLine(unsigned int curY) const {
-    return m_Storage[m_YOffset + curY].size();
+    return lineLength(lineAt(curY));
 }
 
 unsigned int CTextStorage::endOfPrevLine(unsigned int curY) const {
-    return m_Storage[m_YOffset + curY - 1].size();
+    return lineLength(lineAt(curY) - 1);
 }
 
-std::wstring CTextStorage::getLine(unsigned int y) const {
-    if (m_YOffset + y >= m_Storage.size())
-        return L"";
+CTextStorage::TLineView CTextStorage::getLine(unsigned int y) const {
+    return getStorageLine(lineAt(y));
+}
+
+CTextStorage::TLineView CTextStorage::getStorageLine(size_t line) const {
+    if (line >= availableLines(line))
+        return TLineView{L"", 0};
+    const std::wstring & text = lineText(line);
+    return TLineView{text.data(), text.size()};
+}
+
+std::shared_ptr<const CTextBuffer> CTextStorage::snapshot(size_t line) const {
+    availableLines(line);
+    return m_Buffer -> snapshot();
+}
 
-    return m_Storage[m_YOffset + y];
+size_t CTextStorage::revision() const {
+    return m_Revision;
+}
+
+void CTextStorage::takeSplices(std::vector<CLineStates::TSplice> & splices) {
+    splices.insert(splices.end(), m_Splices.begin(), m_Splices.end());
+    m_Splices.clear();
 }
 
 int CTextStorage::saveToFile(const std::string & fileName, const std::string & folderName) const {
@@ -157,68 +327,264 @@ int CTextStorage::saveToFile(const std::string & fileName, const std::string & f
 }
 
 int CTextStorage::forceSaveToFile(const std::string & fileName, const std::string & folderName) const {
-    std::ofstream out(folderName + "/" + fileName);
-    if (!out.is_open())
+    // file may be memory mapped by the buffer, so it can not be rewritten - new file replaces it instead
+    std::string path = folderName + "/" + fileName;
+    if (m_Autosave && m_Autosave -> moveTo(path, m_Revision)) // text has already been written by autosave
+        return 0;
+    CAtomicFile file(path);
+    if (!file.good())
         return 1;
 
-    bool first = true;
-    for (const auto & line : m_Storage) {
-        if (!first)
-            out << '\n';
-        out << CConverter::toString(line);
-        first = false;
-    }
-    out.close();
-    return 0;
+    availableLines(m_NoLine); // entire file must be loaded
+    std::string text;
+    m_Buffer -> read(0, m_Buffer -> size(), text);
+    file.write(text.data(), text.size()); // whole text is written at once
+    return file.commit() ? 0 : 1;
 }
 
 bool CTextStorage::load(const std::string & fileName) {
-    std::ifstream in(fileName);
-    if (!in.is_open())
+    auto file = std::make_shared<CMappedFile>();
+    if (!file -> open(fileName))
         return false;
-    m_Storage.clear(); // if m_Storage was already used, it will be cleared
+
+    size_t len = file -> size();
+    if (len > 0 && file -> data()[len - 1] == '\n') // '\n' at the end of file does not create new line
+        --len;
+
+    delete m_Loader; // if storage was already used, it will be cleared
+    delete m_Buffer;
+    if (len > m_RopeThreshold)
+        m_Buffer = new CRope(file);
+    else
+        m_Buffer = new CPieceTable(file);
+
+    // beginning of the file is loaded right away (so that it can be displayed), the rest is loaded in background
+    CLoader::TChunk first;
+    CLoader::nextChunk(file -> data(), 0, len, m_FirstChunk, first);
+    m_Buffer -> appendOriginal(first.len, first.breaks);
+    m_Loader = first.len < len ? new CLoader(file, first.len, len) : nullptr;
+
+    m_CachedLine = m_NoLine;
+    m_Undo.clear();
+    m_Splices.clear();
+    m_Splices.push_back(CLineStates::TSplice{0, CLineStates::m_AllLines, 1});
+    ++m_Revision;
     m_YOffset = 0;
     m_XOffset = 0;
+    if (m_Wrap) { // layout is built for the new text
+        m_Wrap = false;
+        setSoftWrap(true);
+    }
+    damageAll();
+    return true;
+}
 
-    size_t i = 0;
-
-    std::string temp;
-    while (getline(in, temp)) {
-        m_Storage.emplace_back();
-        m_Storage[i++] = CConverter::toWString(temp);
+void CTextStorage::enableAutosave(const std::string & fileName) {
+    delete m_Autosave;
+    m_Autosave = new CAutosave(fileName);
+    m_AutosaveRevision = m_Revision; // text itself does not have to be saved until it changes
+    m_LastAutosave = std::chrono::steady_clock::now();
+}
+
+void CTextStorage::disableAutosave() {
+    if (!m_Autosave)
+        return;
+    m_Autosave -> remove();
+    delete m_Autosave;
+    m_Autosave = nullptr;
+}
+
+void CTextStorage::autosave() {
+    if (!m_Autosave || m_Revision == m_AutosaveRevision)
+        return;
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration_cast<std::chrono::seconds>(now - m_LastAutosave).count() < m_AutosaveInterval)
+        return;
+    availableLines(0);
+    if (m_Loader) // file has not been loaded yet, incomplete text must not be saved
+        return;
+
+    m_Autosave -> save(m_Buffer -> snapshot(), m_Revision);
+    m_AutosaveRevision = m_Revision;
+    m_LastAutosave = now;
+}
+
+void CTextStorage::startJournal(const std::string & fileName, const std::string & noteFile,
+                                const std::vector<CSwapJournal::TRecord> & replay) {
+    delete m_Journal;
+    m_Journal = new CSwapJournal(fileName, noteFile);
+    if (replay.empty())
+        return;
+
+    availableLines(m_NoLine); // records can change any part of the text
+    m_Undo.beginGroup();
+    for (const auto & record : replay) {
+        if (record.pos + (record.insert ? 0 : record.len) > m_Buffer -> size()) // journal does not match the text
+            break;
+        if (record.insert)
+            insertText(record.pos, record.text); // replayed changes are written to the new journal as well
+        else
+            eraseText(record.pos, record.len);
     }
+    m_Undo.endGroup();
+    m_Journal -> flush(true);
+}
 
-    in.close();
-    return true;
+void CTextStorage::flushJournal(bool force) {
+    if (m_Journal)
+        m_Journal -> flush(force);
+}
+
+void CTextStorage::stopJournal() {
+    if (!m_Journal)
+        return;
+    m_Journal -> remove();
+    delete m_Journal;
+    m_Journal = nullptr;
+}
+
+CTextBuffer::TMemoryStats CTextStorage::memoryStats() const {
+    CTextBuffer::TMemoryStats stats;
+    m_Buffer -> memoryStats(stats);
+    stats.overhead += m_CachedBytes.capacity() + m_CachedText.capacity() * sizeof(wchar_t);
+    stats.allocations += 2;
+    stats.overhead += m_Undo.memoryUsage();
+    stats.allocations += m_Undo.allocations();
+    if (m_Wrap) {
+        stats.overhead += m_Layout.memoryUsage();
+        stats.allocations += 2;
+    }
+    stats.overhead += m_Splices.capacity() * sizeof(CLineStates::TSplice);
+    stats.allocations += 1;
+    return stats;
 }
 
 unsigned int CTextStorage::getNumOfLines() const {
-    return m_Storage.size();
+    return availableLines(m_NoLine);
 }
 
-const std::wstring & CTextStorage::getLastLine() const {
-   return m_Storage.back();
+std::wstring CTextStorage::getLastLine() const {
+   return lineText(availableLines(m_NoLine) - 1);
 }
 
 bool CTextStorage::canScrollLineRight(unsigned int curY) const {
-    return (m_XOffset + m_Cols <= m_Storage[m_YOffset + curY].length());
+    size_t line = lineAt(curY);
+    if (m_Wrap || line >= availableLines(line))
+        return false;
+    return (m_XOffset + m_Cols <= lineLength(line));
 }
 
 void CTextStorage::scrollRight() {
     ++m_XOffset;
 }
 
-std::vector<std::wstring> CTextStorage::getWindow() const {
+unsigned int CTextStorage::showColumn(size_t col) {
     updateSize();
-    size_t fin = ((m_Lines + m_YOffset) < m_Storage.size()) ? m_Lines + m_YOffset + 1 : m_Storage.size();
-    std::vector<std::wstring> lines;
-    for (size_t i = m_YOffset; i < fin; i++) {
-        if (m_XOffset <= m_Storage[i].size())
-            lines.emplace_back(m_Storage[i].substr(m_XOffset, m_Cols));
-        else
-            lines.emplace_back();
+    if (col >= m_XOffset + m_Cols) // column is behind the right edge, it will be horizontalStep() from it
+        m_XOffset = col - m_Cols + horizontalStep();
+    else if (col < m_XOffset) // column is in front of the left edge, it will be horizontalStep() from it
+        m_XOffset = col + 1 > horizontalStep() ? col + 1 - horizontalStep() : 0;
+    return col - m_XOffset;
+}
+
+void CTextStorage::setHorizontalStep(unsigned int percent) {
+    m_HorStep = percent > 100 ? 100 : percent;
+}
+
+void CTextStorage::setSoftWrap(bool wrap) {
+    updateSize();
+    size_t top = lineAt(0); // first displayed line stays at the top
+    m_Wrap = wrap;
+    m_XOffset = 0;
+    if (wrap) {
+        std::vector<size_t> lengths(availableLines(m_NoLine));
+        for (size_t line = 0; line < lengths.size(); ++line)
+            lengths[line] = lineLength(line);
+        m_Layout.assign(lengths);
+        m_YOffset = m_Layout.rowOf(std::min(top, lengths.size() - 1));
+    }
+    else {
+        m_Layout.clear();
+        m_YOffset = top;
+    }
+    damageAll();
+}
+
+bool CTextStorage::softWrap() const {
+    return m_Wrap;
+}
+
+CTextStorage::TLineView CTextStorage::getScreenLine(unsigned int y) const {
+    updateSize();
+    size_t line = lineAt(y);
+    if (line >= availableLines(line))
+        return TLineView{L"", 0};
+    size_t start = colAt(y, 0);
+    const std::wstring & text = lineText(line);
+    if (start >= text.size())
+        return TLineView{L"", 0};
+    return TLineView{text.data() + start, std::min<size_t>(text.size() - start, m_Cols)};
+}
+
+bool CTextStorage::takeScroll(TScroll & scroll) {
+    updateSize();
+    long height = m_Lines + 1;
+    long offset = (long) m_YOffset - (long) m_ShownYOffset;
+    long row = 0;
+    long count = 0;
+    if (m_ShiftRow != m_NoLine) {
+        if (m_ShiftRow < m_YOffset) // moved rows fill entire window
+            offset -= m_Shift;
+        else if (m_ShiftRow < m_YOffset + (size_t) height) {
+            row = m_ShiftRow - m_YOffset;
+            count = std::max(-(height - row), std::min(m_Shift, height - row));
+        }
+    }
+    if (m_XOffset != m_ShownXOffset || (m_DamageFrom == 0 && m_DamageTo == m_NoLine) || offset <= -height
+        || offset >= height) // takeDamage() repaints entire window
+        return false;
+    m_ShownYOffset = m_YOffset;
+    m_ShiftRow = m_NoLine;
+    if (offset == 0 && count == 0)
+        return false;
+    scroll.offset = offset;
+    scroll.row = row;
+    scroll.count = count;
+    return true;
+}
+
+bool CTextStorage::takeDamage(unsigned int & from, unsigned int & to) {
+    updateSize();
+    if (m_ShiftRow != m_NoLine) { // rows have not been moved by takeScroll()
+        damage(m_ShiftLine, m_NoLine);
+        m_ShiftRow = m_NoLine;
+    }
+    if (m_YOffset != m_ShownYOffset || m_XOffset != m_ShownXOffset) { // all displayed lines have moved
+        damageAll();
+        m_ShownYOffset = m_YOffset;
+        m_ShownXOffset = m_XOffset;
+    }
+    size_t first = m_DamageFrom;
+    size_t last = m_DamageTo;
+    if (m_Wrap) { // damaged lines are converted to rows
+        if (first != m_NoLine)
+            first = m_Layout.rowOf(std::min(first, m_Layout.lineCount()));
+        last = last < m_Layout.lineCount() ? m_Layout.rowOf(last) : m_NoLine;
     }
-    return lines;
+    first = std::max<size_t>(first, m_YOffset);
+    last = std::min<size_t>(last, m_YOffset + m_Lines + 1);
+    m_DamageFrom = m_NoLine;
+    m_DamageTo = 0;
+    if (first >= last)
+        return false;
+    from = first - m_YOffset;
+    to = last - m_YOffset;
+    return true;
+}
+
+void CTextStorage::damageAll() {
+    m_ShiftRow = m_NoLine;
+    damage(0, m_NoLine);
 }
 
 bool CTextStorage::canScrollLeft() const {
@@ -229,6 +595,11 @@ void CTextStorage::scrollLeft() {
     --m_XOffset;
 }
 
+unsigned int CTextStorage::horizontalStep() const {
+    unsigned int step = m_Cols * m_HorStep / 100;
+    return step > 0 ? step : 1;
+}
+
 unsigned int CTextStorage::calculateLinePos(bool & redraw, unsigned int size, unsigned int curX) {
     if (size < m_XOffset) {
         redraw = true; // window must be scrolled to the left
@@ -247,15 +618,16 @@ unsigned int CTextStorage::moveScreenToHorPos(unsigned int index) {
 }
 
 wchar_t CTextStorage::getChar(unsigned int y, unsigned int x, bool yToW, bool xToW) const {
-    unsigned int yToS = yToW ? y + m_YOffset : y; // represent Y relative to storage
-    unsigned int xToS = xToW ? x + m_XOffset : x; // represent X relative to storage
+    size_t yToS = yToW ? lineAt(y) : y; // represent Y relative to storage
+    size_t xToS = xToW ? (yToW ? colAt(y, x) : x + m_XOffset) : x; // represent X relative to storage
 
-    if (yToS >= m_Storage.size())
+    if (yToS >= availableLines(yToS))
         return L'\0';
-    if (xToS >= m_Storage[yToS].size())
+    const std::wstring & text = lineText(yToS);
+    if (xToS >= text.size())
         return L'\0';
 
-    return m_Storage[yToS][xToS];
+    return text[xToS];
 }
 
 bool CTextStorage::isOnScreen(unsigned int y, unsigned int x) const {
@@ -275,10 +647,240 @@ unsigned int CTextStorage::convertGlobalX(unsigned int x) const {
 }
 
 unsigned int CTextStorage::convertScreenY(unsigned int y) const {
-   return y + m_YOffset;
+   return lineAt(y);
 }
 
 unsigned int CTextStorage::convertScreenX(unsigned int x) const {
     return x + m_XOffset;
 }
 
+size_t CTextStorage::convertScreenX(unsigned int y, unsigned int x) const {
+    return colAt(y, x);
+}
+
+bool CTextStorage::convertColToScreen(unsigned int y, size_t col, unsigned int & x) const {
+    updateSize();
+    size_t start = colAt(y, 0);
+    if (col < start || col >= start + m_Cols)
+        return false;
+    x = col - start;
+    return true;
+}
+
+size_t CTextStorage::availableLines(size_t line) const {
+    if (!m_Loader)
+        return m_Buffer -> lineCount();
+
+    // lines before the last one are complete, the last one may continue in next chunk
+    CLoader::TChunk chunk;
+    while (m_Loader -> take(chunk, line + 1 >= m_Buffer -> lineCount() || line == m_NoLine)) {
+        m_Buffer -> appendOriginal(chunk.len, chunk.breaks);
+        m_CachedLine = m_NoLine;
+    }
+    if (m_Loader -> finished()) {
+        delete m_Loader;
+        m_Loader = nullptr;
+    }
+    return m_Buffer -> lineCount();
+}
+
+const std::wstring & CTextStorage::lineText(size_t line) const {
+    if (m_CachedLine != line) {
+        availableLines(line);
+        m_Buffer -> getLine(line, m_CachedBytes);
+        CConverter::decode(m_CachedBytes.data(), m_CachedBytes.size(), m_CachedText);
+        m_CachedLine = line;
+    }
+    return m_CachedText;
+}
+
+size_t CTextStorage::lineLength(size_t line) const {
+    return lineText(line).size();
+}
+
+size_t CTextStorage::bufferPos(size_t line, size_t col) const {
+    lineText(line); // makes sure, that m_CachedBytes contains given line
+    return m_Buffer -> lineStart(line) + CConverter::charOffset(m_CachedBytes.data(), m_CachedBytes.size(), col);
+}
+
+size_t CTextStorage::insertAtCursor(const std::wstring & text, unsigned int curY, unsigned int curX) {
+    updateSize();
+    size_t line = lineAt(curY);
+    size_t col = colAt(curY, curX);
+
+    std::string bytes;
+    bool newLine = line >= availableLines(line);
+    if (newLine) // new line is created at the end
+        bytes += '\n';
+    for (wchar_t c : text)
+        CConverter::encode(c, bytes);
+    size_t pos = newLine ? m_Buffer -> size() : bufferPos(line, col);
+    insertText(pos, bytes);
+    return pos + bytes.size();
+}
+
+size_t CTextStorage::lineAt(unsigned int y) const {
+    if (!m_Wrap)
+        return m_YOffset + y;
+    size_t row = m_YOffset + y;
+    size_t total = m_Layout.totalRows();
+    if (row >= total) // every row behind the text is counted as one line
+        return m_Layout.lineCount() + row - total;
+    size_t first;
+    return m_Layout.lineOfRow(row, first);
+}
+
+size_t CTextStorage::colAt(unsigned int y, unsigned int x) const {
+    if (!m_Wrap)
+        return m_XOffset + x;
+    updateSize();
+    size_t row = m_YOffset + y;
+    if (row >= m_Layout.totalRows())
+        return x;
+    size_t first;
+    m_Layout.lineOfRow(row, first);
+    return (row - first) * m_Cols + x;
+}
+
+size_t CTextStorage::rowOf(size_t line, size_t col) const {
+    updateSize();
+    return m_Layout.rowOf(line) + col / m_Cols;
+}
+
+int CTextStorage::wrapMove(bool & redraw, bool up, unsigned int curY, unsigned int curX) {
+    size_t row = m_YOffset + curY;
+    if (up ? row == 0 : row + 1 >= m_Layout.totalRows())
+        return -1;
+    if (up && curY == 0) {
+        --m_YOffset;
+        redraw = true;
+    }
+    else if (!up && curY == m_Lines) {
+        ++m_YOffset;
+        redraw = true;
+    }
+    row = up ? row - 1 : row + 1;
+    size_t first;
+    size_t line = m_Layout.lineOfRow(row, first);
+    size_t start = (row - first) * m_Cols; // index of first char on the row
+    return std::min<size_t>(start + curX, lineLength(line)) - start;
+}
+
+void CTextStorage::updateLayout(size_t line, size_t removed, size_t added, size_t & rowsBefore, size_t & rowsAfter) {
+    rowsBefore = 0;
+    for (size_t i = line; i < line + removed; ++i)
+        rowsBefore += m_Layout.rows(i);
+    if (removed != 1 || added != 1)
+        m_Layout.splice(line, removed, added);
+    rowsAfter = 0;
+    for (size_t i = line; i < line + added; ++i) {
+        m_Layout.setLength(i, lineLength(i));
+        rowsAfter += m_Layout.rows(i);
+    }
+}
+
+void CTextStorage::textChanged(size_t line, size_t before) {
+    m_CachedLine = m_NoLine;
+    size_t after = m_Buffer -> lineCount();
+    size_t removed = before > after ? 1 + before - after : 1; // lines that contained changed text
+    size_t added = after > before ? 1 + after - before : 1; // lines that contain changed text now
+    size_t rowsBefore = removed;
+    size_t rowsAfter = added;
+    if (m_Splices.size() == m_MaxSplices)
+        m_Splices.assign(1, CLineStates::TSplice{0, CLineStates::m_AllLines, 1});
+    m_Splices.push_back(CLineStates::TSplice{line, removed, added});
+    if (m_Wrap)
+        updateLayout(line, removed, added, rowsBefore, rowsAfter);
+    if (rowsBefore == rowsAfter) { // rows below changed lines stay where they are
+        damage(line, line + added);
+        return;
+    }
+    size_t row = (m_Wrap ? m_Layout.rowOf(line) : line) + std::min(rowsBefore, rowsAfter);
+    long count = (long) rowsAfter - (long) rowsBefore;
+    if (m_ShiftRow == m_NoLine && (m_DamageFrom == m_NoLine || m_DamageTo <= line + 1)) {
+        // rows below can be moved by takeScroll(), damage (in rows) before this change is not affected by it
+        m_ShiftRow = row;
+        m_ShiftLine = line;
+        m_Shift = count;
+        damage(line, line + added);
+        return;
+    }
+    // only one movement is remembered, all rows below both changes are repainted
+    damage(m_ShiftRow == m_NoLine ? line : std::min(line, m_ShiftLine), m_NoLine);
+    m_ShiftRow = m_NoLine;
+}
+
+size_t CTextStorage::lineOf(size_t pos) const {
+    size_t first = 0;
+    size_t last = m_Buffer -> lineCount() - 1;
+    while (first < last) { // finds last line, that starts before pos
+        size_t mid = first + (last - first + 1) / 2;
+        if (m_Buffer -> lineStart(mid) <= pos)
+            first = mid;
+        else
+            last = mid - 1;
+    }
+    return first;
+}
+
+void CTextStorage::damage(size_t from, size_t to) {
+    m_DamageFrom = std::min(m_DamageFrom, from);
+    m_DamageTo = std::max(m_DamageTo, to);
+}
+
+void CTextStorage::storagePos(size_t pos, size_t & line, size_t & col) const {
+    line = lineOf(pos); // changed text is always loaded
+    lineText(line); // makes sure, that m_CachedBytes contains given line
+    std::wstring prefix;
+    CConverter::decode(m_CachedBytes.data(), pos - m_Buffer -> lineStart(line), prefix);
+    col = prefix.size();
+}
+
+void CTextStorage::applyChanges(const std::vector<CUndoLog::TChange> & changes, unsigned int & curY,
+                                unsigned int & curX) {
+    size_t pos = 0;
+    for (const auto & change : changes) {
+        if (change.insert) {
+            insertText(change.pos, change.text, false);
+            pos = change.pos + change.text.size();
+        }
+        else {
+            eraseText(change.pos, change.text.size(), false);
+            pos = change.pos;
+        }
+    }
+    size_t line, col;
+    storagePos(pos, line, col);
+    moveTo(line, col, curY, curX);
+}
+
+void CTextStorage::insertText(size_t pos, const std::string & text, bool record) {
+    if (m_Loader && pos >= m_Buffer -> size()) // text can not be appended before the rest of the file
+        availableLines(m_NoLine);
+    size_t line = lineOf(pos);
+    size_t count = m_Buffer -> lineCount();
+    m_Buffer -> insert(pos, text.data(), text.size());
+    textChanged(line, count);
+    ++m_Revision;
+    if (record)
+        m_Undo.recordInsert(pos, text);
+    if (m_Journal)
+        m_Journal -> recordInsert(pos, text);
+}
+
+void CTextStorage::eraseText(size_t pos, size_t len, bool record) {
+    if (m_Loader && pos + len >= m_Buffer -> size())
+        availableLines(m_NoLine);
+    if (record) {
+        std::string text;
+        m_Buffer -> read(pos, len, text);
+        m_Undo.recordErase(pos, text);
+    }
+    size_t line = lineOf(pos);
+    size_t count = m_Buffer -> lineCount();
+    m_Buffer -> erase(pos, len);
+    textChanged(line, count);
+    ++m_Revision;
+    if (m_Journal)
+        m_Journal -> recordErase(pos, len);
+}
@@ -5,22 +5,43 @@
 
 #pragma once
 
+#include "CTextBuffer.h"
+#include "CLoader.h"
+#include "CUndoLog.h"
+#include "CAutosave.h"
+#include "CSwapJournal.h"
+#include "CWrapLayout.h"
+#include "CLineStates.h"
+
+#include <chrono>
 #include <string>
 #include <vector>
 #include <codecvt>
 #include <locale>
 
 /**
- * Stores text written into CTextEditor (Ncurses store only currently displayed text)
+ * Stores text written into CTextEditor (Ncurses store only currently displayed text). Text itself is kept in CTextBuffer
+ * (as UTF-8), this class translates screen coordinates used by the editor to positions in the buffer. In soft wrap mode
+ * long lines are split into more rows of the screen (see CWrapLayout) instead of being scrolled horizontally.
  */
 class CTextStorage {
 public:
+    /**
+     * Read-only view of (part of) a stored line. It points to the line cache of CTextStorage, so it is valid only until
+     * next call of any method of CTextStorage.
+     */
+    struct TLineView {
+        const wchar_t * text;
+        size_t len;
+    };
+
     /**
      * Creates new CTextStorage.
      * @param yDif[in] How many lines are NOT used by the text editor.
      * @param xDif[in] How many columns are NOT used by the text editor.
      */
     CTextStorage(int yDif = 0, int xDif = 0);
+    ~CTextStorage();
     CTextStorage(const CTextStorage &) = delete; // may be implemented later on
     CTextStorage & operator = (const CTextStorage &) = delete; // may be implemented later on
 
@@ -33,6 +54,23 @@ public:
      */
     void inputChar(wchar_t c, unsigned int curY, unsigned int curX);
 
+    /**
+     * Stores given text at once (same as calling inputChar() for every char, but the buffer is changed only once).
+     * @param[in] text Text typed in text editor (must not contain newlines).
+     * @param[in] curY Cursor Y coordinate.
+     * @param[in] curX Cursor X coordinate.
+     */
+    void inputText(const std::wstring & text, unsigned int curY, unsigned int curX);
+
+    /**
+     * Inserts given text (it can contain newlines) by one change, that is undone at once. Cursor is moved behind the
+     * inserted text (screen is scrolled only if the end of the text is not visible).
+     * @param[in] text Pasted text.
+     * @param[in,out] curY Cursor Y coordinate.
+     * @param[in,out] curX Cursor X coordinate.
+     */
+    void pasteText(const std::wstring & text, unsigned int & curY, unsigned int & curX);
+
     /**
      * Deletes given char. If there are other characters to the right of current cursor positions, they are moved to the
      * left.
@@ -59,7 +97,7 @@ public:
      * should usually be called first.
      * @return New first line.
      */
-    const std::wstring & scrollUp();
+    std::wstring scrollUp();
 
     /**
      * Represents text editor scrolling down - first line is hidden, last line is taken from storage.
@@ -67,7 +105,7 @@ public:
      * @param[in] curY Cursor Y coordinate.
      * @return New last line.
      */
-    const std::wstring & scrollDown();
+    std::wstring scrollDown();
 
     /**
      * Determines whether or not a cursor can move to right. (Cursor can not move on "void" - place without text)
@@ -99,6 +137,63 @@ public:
      */
      int MoveDown(bool & redraw, unsigned int curY, unsigned int curX);
 
+    /**
+     * Moves cursor to given position in storage. Screen is scrolled only if given position is not visible.
+     * @param[in] line Index of line in storage (if it is bigger than index of last line, last line is used).
+     * @param[in] col Index of char on given line (if it is bigger than length of line, end of line is used).
+     * @param[out] curY Cursor Y coordinate after movement.
+     * @param[out] curX Cursor X coordinate after movement.
+     * @return True if screen has been scrolled (editor window MUST be redrawn), false otherwise.
+     */
+    bool moveTo(size_t line, size_t col, unsigned int & curY, unsigned int & curX);
+
+    /**
+     * Scrolls screen by one page (height of the editor) up or down, cursor is moved by the same number of lines.
+     * @param[in] down True if screen should be scrolled down, false if up.
+     * @param[in,out] curY Cursor Y coordinate.
+     * @param[in,out] curX Cursor X coordinate.
+     * @return True if screen has been scrolled (editor window MUST be redrawn), false otherwise.
+     */
+    bool movePage(bool down, unsigned int & curY, unsigned int & curX);
+
+    /**
+     * @param[in] percent Position in the text in percent (bigger values are treated as 100).
+     * @return Index of line, that is on given position in the text.
+     */
+    size_t lineAtPercent(unsigned int percent) const;
+
+    /**
+     * Undoes last change (or group of changes) of the text and moves screen to the place of the change.
+     * @param[out] curY Cursor Y coordinate after undo.
+     * @param[out] curX Cursor X coordinate after undo.
+     * @return True if something has been undone (editor window MUST be redrawn), false otherwise.
+     */
+    bool undo(unsigned int & curY, unsigned int & curX);
+
+    /**
+     * Redoes last undone change (or group of changes) of the text and moves screen to the place of the change.
+     * @param[out] curY Cursor Y coordinate after redo.
+     * @param[out] curX Cursor X coordinate after redo.
+     * @return True if something has been redone (editor window MUST be redrawn), false otherwise.
+     */
+    bool redo(unsigned int & curY, unsigned int & curX);
+
+    /**
+     * All changes done until endUndoGroup() is called will be undone at once.
+     */
+    void beginUndoGroup();
+
+    /**
+     * Ends group started by beginUndoGroup().
+     */
+    void endUndoGroup();
+
+    /**
+     * Changes how much memory can be used by undo history (oldest changes are forgotten first).
+     * @param[in] limit Limit in bytes.
+     */
+    void setUndoLimit(size_t limit);
+
     /**
      * @return True if screen can be scrolled up, false otherwise
      */
@@ -126,7 +221,7 @@ public:
      * @param[in] curX Cursor X coordinate on screen.
      * @return New line content.
      */
-    const std::wstring & moveEndOfLineDown(unsigned int curY, unsigned int curX);
+    std::wstring moveEndOfLineDown(unsigned int curY, unsigned int curX);
 
     /**
      * @param[in] curY Cursor Y coordinate.
@@ -141,11 +236,38 @@ public:
     unsigned int endOfPrevLine(unsigned int curY) const;
 
     /**
-     * Returns given line, that should be displayed on screen.
+     * Returns given line, that should be displayed on screen. Line is not copied (see TLineView).
      * @param[in] y Line on screen that should be returned.
-     * @return Text of given line.
+     * @return Text of given line (empty if there is no such line).
      */
-    std::wstring getLine(unsigned int y) const;
+    TLineView getLine(unsigned int y) const;
+
+    /**
+     * Returns line with given index in storage. Line is not copied (see TLineView).
+     * @param[in] line Index of line in storage.
+     * @return Text of given line (empty if there is no such line).
+     */
+    TLineView getStorageLine(size_t line) const;
+
+    /**
+     * Creates snapshot of the text, that can be read by another thread (see CTextBuffer::snapshot()).
+     * @param[in] line Index of line, that should be in the snapshot (if the file is being loaded, it is loaded up to
+     * this line).
+     * @return Snapshot of the text.
+     */
+    std::shared_ptr<const CTextBuffer> snapshot(size_t line) const;
+
+    /**
+     * @return Revision of the text (it is incremented by every change).
+     */
+    size_t revision() const;
+
+    /**
+     * Moves changes of lines made since the last call to given vector, they are used to update states of the parser of
+     * the format (see CLineStates::splice()). Load of other text removes all lines.
+     * @param[in, out] splices Vector, to which changes are appended.
+     */
+    void takeSplices(std::vector<CLineStates::TSplice> & splices);
 
     /**
      * Attempts to save file with given name.
@@ -156,7 +278,8 @@ public:
     int saveToFile(const std::string & fileName, const std::string & folderName = "") const;
 
     /**
-     * Saves file even if file with given name already exists.
+     * Saves file even if file with given name already exists. If text has not been changed since the last autosave,
+     * autosaved file is used.
      * @param[in] fileName Name of file/note (with extension)
      * @return 0 if saving was successful, 1 if file can not be created
      */
@@ -164,11 +287,56 @@ public:
 
     /**
      * Clears the storage and load note from given file. If loading content from the file fails, storage is not cleared.
+     * Files bigger than m_RopeThreshold are stored in CRope, smaller ones in CPieceTable. Only the beginning of the file
+     * is loaded before this method returns, the rest is loaded in background (methods that need lines, that have not
+     * been loaded yet, wait for them).
      * @param[in] fileName Name of file from which content should be loaded.
      * @return True if file was successfully loaded, false otherwise.
      */
     bool load(const std::string & fileName);
 
+    /**
+     * Enables periodic saving of the text to given file (see autosave()). Text is written in background thread.
+     * @param[in] fileName File to which text will be saved.
+     */
+    void enableAutosave(const std::string & fileName);
+
+    /**
+     * Disables autosave and deletes the autosaved file.
+     */
+    void disableAutosave();
+
+    /**
+     * Passes snapshot of the text to autosave, if text has changed and at least m_AutosaveInterval has passed since the
+     * last autosave. Should be called regularly (even if user does not type). Returns immediately.
+     */
+    void autosave();
+
+    /**
+     * Starts swap journal, to which every change of text will be written (previous journal in the file is replaced).
+     * @param[in] fileName File of the journal.
+     * @param[in] noteFile File from which text has been loaded ("" if it is a new note).
+     * @param[in] replay Records of previous journal, that should be applied to the text (they are undone as one).
+     */
+    void startJournal(const std::string & fileName, const std::string & noteFile,
+                      const std::vector<CSwapJournal::TRecord> & replay = {});
+
+    /**
+     * Writes changes buffered by swap journal to it's file.
+     * @param[in] force If false, changes are written only if enough of them has been buffered (or enough time passed).
+     */
+    void flushJournal(bool force);
+
+    /**
+     * Stops swap journal and deletes it's file (should be called when note is saved or discarded).
+     */
+    void stopJournal();
+
+    /**
+     * @return Memory used by stored text (including undo history and caches).
+     */
+    CTextBuffer::TMemoryStats memoryStats() const;
+
     /**
      * @return Number of lines stored.
      */
@@ -177,7 +345,7 @@ public:
     /**
      * @return Last line.
      */
-    const std::wstring & getLastLine() const;
+    std::wstring getLastLine() const;
 
     /**
      * Checks if text can be scrolled to the right (current line continue to the right).
@@ -187,18 +355,92 @@ public:
     bool canScrollLineRight(unsigned int curY) const;
 
     /**
-     * Moves screen representation inside CTextStorage to the right. Use .getWindow() to print new screen.
+     * Moves screen representation inside CTextStorage to the right. Screen is damaged (see takeDamage()).
      */
     void scrollRight();
 
     /**
-     * Returns all lines in current window (this is useful when lot's of changes are done at the same time - for example
-     * enter key can scroll the entire screen to the left by many columns at once). Printing the entire output of this
-     * function will synchronize displayed text with m_Storage. Does NOT return blank lines at the end, so erasing screen
-     * before hand is a good idea.
-     * @return All ines in current window.
+     * Scrolls screen horizontally (if needed) so that given column of the text is visible. Screen is scrolled by the
+     * horizontal step (see setHorizontalStep()), so that following columns in the same direction are visible without
+     * another scrolling. Screen is not scrolled back until cursor leaves it on the other side. Screen is damaged if it
+     * scrolls (see takeDamage()).
+     * @param[in] col Index of char on the line (column in storage).
+     * @return Screen X coordinate of given column.
+     */
+    unsigned int showColumn(size_t col);
+
+    /**
+     * Sets how far screen scrolls horizontally, when cursor leaves it (see showColumn()).
+     * @param[in] percent Step in percent of the width of the editor (0 - 100), 0 means one column.
+     */
+    static void setHorizontalStep(unsigned int percent);
+
+    /**
+     * Turns soft wrap mode on or off. In soft wrap mode every line takes as many rows of the screen as it needs and the
+     * screen never scrolls horizontally. Vertical offset then counts rows instead of lines. Turning soft wrap on loads
+     * entire file. Screen is damaged (see takeDamage()), cursor should be moved by moveTo() afterwards.
+     * @param[in] wrap True to turn soft wrap on.
+     */
+    void setSoftWrap(bool wrap);
+
+    /**
+     * @return True if soft wrap mode is on.
+     */
+    bool softWrap() const;
+
+    /**
+     * Returns part of given line, that is visible on screen (with respect to horizontal scrolling). Line is not copied
+     * (see TLineView).
+     * @param[in] y Line on screen.
+     * @return Visible text of given line (empty if there is no such line).
      */
-    std::vector<std::wstring> getWindow() const;
+    TLineView getScreenLine(unsigned int y) const;
+
+    /**
+     * Calls visitor(y, view) for every row of the editor window in given range, view is the visible part of the line on
+     * that row (see getScreenLine()). View must not be used after visitor returns.
+     * @param[in] from First row.
+     * @param[in] to Row after the last row.
+     * @param[in] visitor Callable with parameters (unsigned int y, TLineView view).
+     */
+    template <typename TVisitor>
+    void visitScreenLines(unsigned int from, unsigned int to, TVisitor visitor) const {
+        for (unsigned int y = from; y < to; ++y)
+            visitor(y, getScreenLine(y));
+    }
+
+    /**
+     * Movement of rows of the editor window (see takeScroll()).
+     */
+    struct TScroll {
+        int offset; // number of rows, by which entire window is scrolled (positive moves text up)
+        unsigned int row; // row (after scrolling by offset), at which rows are inserted or deleted
+        int count; // number of inserted (positive) or deleted (negative) rows, rows below them move
+    };
+
+    /**
+     * Returns, how displayed rows have moved since the last call of this method (or of takeDamage()), so that window
+     * can move them (and repaint only rows, that it leaves blank) instead of repainting them. Has to be called before
+     * takeDamage(), rows returned by takeDamage() afterwards are in the moved window.
+     * @param[out] scroll Movement of rows.
+     * @return False if rows have not moved, or if they have moved so much, that takeDamage() returns entire window.
+     */
+    bool takeScroll(TScroll & scroll);
+
+    /**
+     * Returns rows of the editor window, that have to be repainted since the last call of this method. Rows are damaged
+     * by every change of text (change that adds or removes line damages all rows below it as well, unless they have
+     * been moved by takeScroll()), scrolling damages entire window (unless it has been done by takeScroll()).
+     * @param[out] from First row, that has to be repainted.
+     * @param[out] to Row after the last row, that has to be repainted.
+     * @return False if nothing has to be repainted.
+     */
+    bool takeDamage(unsigned int & from, unsigned int & to);
+
+    /**
+     * Marks entire window to be repainted by next takeDamage() (for example when popup window has been displayed over it).
+     */
+    void damageAll();
 
     /**
      * @return True if screen be scrolled left (one column);
@@ -206,7 +448,7 @@ public:
     bool canScrollLeft() const;
 
     /**
-     * Inner representation of text will move to the left -> redrawing by using .getWindow() is needed.
+     * Inner representation of text will move to the left -> screen is damaged (see takeDamage()).
      */
     void scrollLeft();
 
@@ -263,20 +505,64 @@ public:
 
     /**
      * Converts given screen x coordinate to "global" coordinate. If given position is not on screen, the behaviour is
-     * undefined.
+     * undefined. Not usable in soft wrap mode (use the overload with y coordinate).
      * @param[in] x X Screen coordinate.
      * @return "Global" equivalent of given screen x coordinate.
      */
     unsigned int convertScreenX(unsigned int x) const;
 
+    /**
+     * Converts given screen position to index of char on the line shown on given row (works in soft wrap mode as well).
+     * @param[in] y Y Screen coordinate.
+     * @param[in] x X Screen coordinate.
+     * @return Index of char on the line (see convertScreenY()).
+     */
+    size_t convertScreenX(unsigned int y, unsigned int x) const;
+
+    /**
+     * Converts index of char on the line shown on given row of the screen to screen x coordinate.
+     * @param[in] y Y Screen coordinate.
+     * @param[in] col Index of char on the line.
+     * @param[out] x Screen x coordinate of the char.
+     * @return False if given char is not visible on given row.
+     */
+    bool convertColToScreen(unsigned int y, size_t col, unsigned int & x) const;
+
 private:
-    std::vector<std::wstring> m_Storage; // stores lines
+    CTextBuffer * m_Buffer; // stores text
     unsigned int m_YDif; // stores how many lines on screen are NOT used by the editor
     unsigned int m_XDif;
     unsigned int m_YOffset; // represents, how much vertical scrolling has been done
     unsigned int m_XOffset; // represents, how much horizontal scrolling has been done
     mutable unsigned int m_Lines; // stores how many lines editor has (must be updated before use - screen res can change)
     mutable unsigned int m_Cols; // stores how many columns editor has (must be updated before use - screen res can change)
+    mutable CLoader * m_Loader; // loads rest of the file in background (nullptr if entire file is loaded)
+    mutable size_t m_CachedLine; // index of line stored in m_CachedBytes/m_CachedText (m_NoLine if none)
+    mutable std::string m_CachedBytes; // raw content of m_CachedLine
+    mutable std::wstring m_CachedText; // decoded content of m_CachedLine
+    CUndoLog m_Undo; // history of changes
+    size_t m_Revision; // incremented by every change of text
+    CAutosave * m_Autosave; // nullptr if autosave is disabled
+    size_t m_AutosaveRevision; // revision of text last passed to m_Autosave
+    std::chrono::steady_clock::time_point m_LastAutosave;
+    CSwapJournal * m_Journal; // nullptr if journal is not used
+    size_t m_DamageFrom; // first line changed since last takeDamage() (m_NoLine if none)
+    size_t m_DamageTo; // line after the last changed line (m_NoLine if all lines until the end are changed)
+    unsigned int m_ShownYOffset; // m_YOffset when takeDamage() was called last time
+    unsigned int m_ShownXOffset;
+    size_t m_ShiftRow; // row (in the text), at which rows have been inserted or deleted (m_NoLine if none)
+    size_t m_ShiftLine; // line, that has been changed by this insertion or deletion
+    long m_Shift; // number of inserted (positive) or deleted (negative) rows
+    static unsigned int m_HorStep; // horizontal scroll step in percent of the width of the editor
+    bool m_Wrap; // true in soft wrap mode (m_YOffset is index of the first displayed row, m_XOffset is 0)
+    mutable CWrapLayout m_Layout; // used only in soft wrap mode
+    std::vector<CLineStates::TSplice> m_Splices; // changes of lines since the last takeSplices()
+
+    static const size_t m_NoLine = (size_t) -1;
+    static const size_t m_RopeThreshold = 16 * 1024 * 1024; // files bigger than this (in bytes) are stored in CRope
+    static const size_t m_FirstChunk = 64 * 1024; // how many bytes are loaded before load() returns
+    static const int m_AutosaveInterval = 3; // minimal number of seconds between two autosaves
+    static const size_t m_MaxSplices = 1024; // more changes, that are not taken, are replaced by removal of all lines
 
 
     /**
@@ -284,6 +570,55 @@ private:
      */
     void updateSize() const;
 
+    /**
+     * @param[in] y Row on screen.
+     * @return Index of line in storage shown on given row (it may be bigger than index of last line).
+     */
+    size_t lineAt(unsigned int y) const;
+
+    /**
+     * @param[in] y Row on screen.
+     * @param[in] x Column on screen.
+     * @return Index of char on the line shown on given position.
+     */
+    size_t colAt(unsigned int y, unsigned int x) const;
+
+    /**
+     * @param[in] line Index of line in storage (line must exist, soft wrap mode only).
+     * @param[in] col Index of char on the line.
+     * @return Index of row (counted from the beginning of the text), that shows given char.
+     */
+    size_t rowOf(size_t line, size_t col) const;
+
+    /**
+     * Soft wrap mode version of MoveUp() and MoveDown().
+     * @param[in] up True for movement up, false for movement down.
+     */
+    int wrapMove(bool & redraw, bool up, unsigned int curY, unsigned int curX);
+
+    /**
+     * Updates m_Layout after change of text (soft wrap mode only).
+     * @param[in] line First changed line.
+     * @param[in] removed Number of lines, that contained changed text.
+     * @param[in] added Number of lines, that contain changed text now.
+     * @param[out] rowsBefore Number of rows of removed lines.
+     * @param[out] rowsAfter Number of rows of added lines.
+     */
+    void updateLayout(size_t line, size_t removed, size_t added, size_t & rowsBefore, size_t & rowsAfter);
+
+    /**
+     * Updates caches and damage after change of text. If rows below the change have moved, movement is remembered for
+     * takeScroll() when possible, otherwise all rows below are damaged.
+     * @param[in] line First changed line.
+     * @param[in] before Number of lines of the text before the change.
+     */
+    void textChanged(size_t line, size_t before);
+
+    /**
+     * @return Number of columns, by which screen is scrolled horizontally (at least 1).
+     */
+    unsigned int horizontalStep() const;
+
     /**
      * Calculates cursor position on line, after movement up or down.
      * @param[in, out]redraw Determines, whether or not window should be scrolled after movement.
@@ -294,6 +629,85 @@ private:
      * @return Position of cursor on new line.
      */
     unsigned int calculateLinePos(bool & redraw, unsigned int size, unsigned int curX);
+
+    /**
+     * Moves chunks of file loaded in background to the buffer. If given line has not been loaded yet, waits for it.
+     * @param[in] line Line that is needed (m_NoLine if entire file is needed).
+     * @return Number of lines in the buffer.
+     */
+    size_t availableLines(size_t line) const;
+
+    /**
+     * Returns decoded text of given line. Returned reference is valid only until next call of any method of this class.
+     * @param[in] line Index of line in storage (line must exist).
+     * @return Text of given line.
+     */
+    const std::wstring & lineText(size_t line) const;
+
+    /**
+     * @param[in] line Index of line in storage (line must exist).
+     * @return Number of chars on given line.
+     */
+    size_t lineLength(size_t line) const;
+
+    /**
+     * Converts position of char in storage to position in buffer.
+     * @param[in] line Index of line in storage (line must exist).
+     * @param[in] col Index of char on given line, if it is bigger than length of line, end of line is used.
+     * @return Position of given char in the buffer.
+     */
+    size_t bufferPos(size_t line, size_t col) const;
+
+    /**
+     * Converts position in buffer to position of char in storage.
+     * @param[in] pos Position in buffer.
+     * @param[out] line Index of line in storage.
+     * @param[out] col Index of char on the line.
+     */
+    void storagePos(size_t pos, size_t & line, size_t & col) const;
+
+    /**
+     * Inserts given text at cursor position (see inputText()).
+     * @return Position in buffer behind the inserted text.
+     */
+    size_t insertAtCursor(const std::wstring & text, unsigned int curY, unsigned int curX);
+
+    /**
+     * @param[in] pos Position in buffer (must be loaded).
+     * @return Index of line, that contains given position.
+     */
+    size_t lineOf(size_t pos) const;
+
+    /**
+     * Marks given lines as changed (they will be returned by takeDamage()).
+     * @param[in] from First changed line.
+     * @param[in] to Line after the last changed line (m_NoLine if all lines until the end are changed).
+     */
+    void damage(size_t from, size_t to);
+
+    /**
+     * Applies changes returned by m_Undo and moves screen to the last of them.
+     * @param[in] changes Changes to apply.
+     * @param[out] curY Cursor Y coordinate after last change.
+     * @param[out] curX Cursor X coordinate after last change.
+     */
+    void applyChanges(const std::vector<CUndoLog::TChange> & changes, unsigned int & curY, unsigned int & curX);
+
+    /**
+     * Inserts text to the buffer, every change of text must be done using this method or eraseText().
+     * @param[in] pos Position in buffer.
+     * @param[in] text UTF-8 text to insert.
+     * @param[in] record If false, change is not recorded to undo history (used by undo itself).
+     */
+    void insertText(size_t pos, const std::string & text, bool record = true);
+
+    /**
+     * Erases text from the buffer, every change of text must be done using this method or insertText().
+     * @param[in] pos Position in buffer.
+     * @param[in] len Number of bytes to erase.
+     * @param[in] record If false, change is not recorded to undo history (used by undo itself).
+     */
+    void eraseText(size_t pos, size_t len, bool record = true);
 };
 
 
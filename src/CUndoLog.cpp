@@ -0,0 +1,151 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CUndoLog.h"
+
+CUndoLog::CUndoLog(size_t limit) : m_Allocations(0), m_Arena(CCountingAllocator<char>(m_Allocations)), m_ArenaStart(0),
+                                   m_Records(CCountingAllocator<TRecord>(m_Allocations)), m_Applied(0), m_Limit(limit),
+                                   m_Group(0), m_Depth(0), m_Sealed(true), m_Dropped(false) {}
+
+void CUndoLog::recordInsert(size_t pos, const std::string & text) {
+    record(true, pos, text);
+}
+
+void CUndoLog::recordErase(size_t pos, const std::string & text) {
+    record(false, pos, text);
+}
+
+void CUndoLog::beginGroup() {
+    if (m_Depth++ == 0) {
+        ++m_Group;
+        m_Sealed = true;
+        m_Dropped = false;
+    }
+}
+
+void CUndoLog::endGroup() {
+    if (m_Depth > 0 && --m_Depth == 0)
+        m_Sealed = true;
+}
+
+void CUndoLog::seal() {
+    m_Sealed = true;
+}
+
+bool CUndoLog::undo(std::vector<TChange> & changes) {
+    changes.clear();
+    if (m_Applied == 0)
+        return false;
+    size_t from = m_Applied - 1;
+    while (from > 0 && m_Records[from - 1].group == m_Records[m_Applied - 1].group)
+        --from;
+    collect(from, m_Applied, true, changes);
+    m_Applied = from;
+    m_Sealed = true;
+    return true;
+}
+
+bool CUndoLog::redo(std::vector<TChange> & changes) {
+    changes.clear();
+    if (m_Applied == m_Records.size())
+        return false;
+    size_t to = m_Applied + 1;
+    while (to < m_Records.size() && m_Records[to].group == m_Records[m_Applied].group)
+        ++to;
+    collect(m_Applied, to, false, changes);
+    m_Applied = to;
+    m_Sealed = true;
+    return true;
+}
+
+void CUndoLog::clear() {
+    m_Arena.clear();
+    m_ArenaStart = 0;
+    m_Records.clear();
+    m_Applied = 0;
+    m_Sealed = true;
+}
+
+void CUndoLog::setLimit(size_t limit) {
+    m_Limit = limit;
+    evict();
+}
+
+size_t CUndoLog::memoryUsage() const {
+    return m_Arena.size() - m_ArenaStart + m_Records.size() * sizeof(TRecord);
+}
+
+size_t CUndoLog::allocations() const {
+    return m_Allocations;
+}
+
+void CUndoLog::record(bool insert, size_t pos, const std::string & text) {
+    if (text.empty() || (m_Depth > 0 && m_Dropped))
+        return;
+    if (m_Applied < m_Records.size()) { // new change makes undone changes impossible to redo
+        m_Arena.resize(m_Records[m_Applied].offset);
+        m_Records.resize(m_Applied);
+        m_Sealed = true;
+    }
+
+    if (!coalesce(insert, pos, text)) {
+        if (m_Depth == 0)
+            ++m_Group;
+        m_Records.push_back(TRecord{pos, m_Arena.size(), (uint32_t) text.size(), m_Group, insert});
+        m_Arena.append(text.data(), text.size());
+        m_Applied = m_Records.size();
+    }
+    // typing is coalesced until the end of line, so that lines are undone one by one
+    m_Sealed = m_Depth == 0 && text.find('\n') != std::string::npos;
+    evict();
+}
+
+bool CUndoLog::coalesce(bool insert, size_t pos, const std::string & text) {
+    if (m_Sealed || m_Records.empty() || m_Records.back().insert != insert || m_Records.back().len >= m_MaxCoalesced)
+        return false;
+    TRecord & last = m_Records.back();
+    if (insert && pos == last.pos + last.len) // typing continues
+        m_Arena.append(text.data(), text.size());
+    else if (!insert && pos == last.pos) // delete key
+        m_Arena.append(text.data(), text.size());
+    else if (!insert && pos + text.size() == last.pos) { // backspace - erased text is before the previous one
+        m_Arena.insert(last.offset, text.data(), text.size());
+        last.pos = pos;
+    }
+    else
+        return false;
+    last.len += text.size();
+    return true;
+}
+
+void CUndoLog::evict() {
+    while (!m_Records.empty() && memoryUsage() > m_Limit) {
+        uint32_t group = m_Records.front().group;
+        if (group == m_Group && m_Depth > 0)
+            m_Dropped = true; // open group is evicted, so it's rest is not recorded
+        while (!m_Records.empty() && m_Records.front().group == group) {
+            m_ArenaStart += m_Records.front().len;
+            m_Records.pop_front();
+            if (m_Applied > 0)
+                --m_Applied;
+        }
+        m_Sealed = true;
+    }
+
+    if (m_ArenaStart > m_Arena.size() / 2) { // evicted text is removed only occasionally, so that eviction is cheap
+        m_Arena.erase(0, m_ArenaStart);
+        for (auto & record : m_Records)
+            record.offset -= m_ArenaStart;
+        m_ArenaStart = 0;
+    }
+}
+
+void CUndoLog::collect(size_t from, size_t to, bool reverse, std::vector<TChange> & changes) const {
+    for (size_t i = from; i < to; ++i) {
+        const TRecord & record = m_Records[reverse ? to - 1 - (i - from) : i];
+        bool insert = reverse ? !record.insert : record.insert;
+        changes.push_back(TChange{insert, record.pos, std::string(m_Arena.data() + record.offset, record.len)});
+    }
+}
@@ -0,0 +1,179 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Log of changes of text, used for undo and redo. Every change is stored as small record (position, length) and it's
+ * text is appended to one shared arena. Consecutive typing (or erasing) is coalesced into one record. Records are
+ * organised in groups - one group is undone/redone at once. Memory used by the log is limited, oldest groups are evicted
+ * when the limit is exceeded.
+ */
+class CUndoLog {
+public:
+    struct TChange {
+        bool insert; // true if text should be inserted, false if it should be erased
+        size_t pos; // position in the buffer
+        std::string text;
+    };
+
+    /**
+     * Creates new empty log.
+     * @param[in] limit Maximal number of bytes used by the log.
+     */
+    explicit CUndoLog(size_t limit = m_DefaultLimit);
+    ~CUndoLog() = default;
+    CUndoLog(const CUndoLog &) = delete;
+    CUndoLog & operator = (const CUndoLog &) = delete;
+
+    /**
+     * Records insertion of text. All changes, that could be redone, are discarded.
+     * @param[in] pos Position where text has been inserted.
+     * @param[in] text Inserted text.
+     */
+    void recordInsert(size_t pos, const std::string & text);
+
+    /**
+     * Records erasure of text. All changes, that could be redone, are discarded.
+     * @param[in] pos Position from which text has been erased.
+     * @param[in] text Erased text.
+     */
+    void recordErase(size_t pos, const std::string & text);
+
+    /**
+     * All changes recorded until endGroup() is called will be undone as one. Groups can be nested.
+     */
+    void beginGroup();
+
+    /**
+     * Ends group started by beginGroup().
+     */
+    void endGroup();
+
+    /**
+     * Next change will not be coalesced with the previous one.
+     */
+    void seal();
+
+    /**
+     * Returns changes, that undo the last group. Changes must be applied (without being recorded) in the given order.
+     * @param[out] changes Changes to apply.
+     * @return False if there is nothing to undo.
+     */
+    bool undo(std::vector<TChange> & changes);
+
+    /**
+     * Returns changes, that redo the last undone group. Changes must be applied (without being recorded) in the given
+     * order.
+     * @param[out] changes Changes to apply.
+     * @return False if there is nothing to redo.
+     */
+    bool redo(std::vector<TChange> & changes);
+
+    /**
+     * Discards all records.
+     */
+    void clear();
+
+    /**
+     * Changes memory limit, evicting oldest groups if needed.
+     * @param[in] limit Maximal number of bytes used by the log.
+     */
+    void setLimit(size_t limit);
+
+    /**
+     * @return Number of bytes used by the log (records and their text).
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @return Number of heap blocks currently allocated by the log (counted by it's containers).
+     */
+    size_t allocations() const;
+
+private:
+    /**
+     * Allocator of containers of the log, that counts blocks they currently hold.
+     */
+    template <typename T>
+    class CCountingAllocator {
+    public:
+        using value_type = T;
+
+        explicit CCountingAllocator(size_t & count) : m_Count(&count) {}
+
+        template <typename U>
+        CCountingAllocator(const CCountingAllocator<U> & other) : m_Count(other.m_Count) {}
+
+        T * allocate(size_t n) {
+            ++*m_Count;
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T * block, size_t n) {
+            --*m_Count;
+            std::allocator<T>().deallocate(block, n);
+        }
+
+        bool operator == (const CCountingAllocator & other) const { return m_Count == other.m_Count; }
+        bool operator != (const CCountingAllocator & other) const { return m_Count != other.m_Count; }
+
+    private:
+        template <typename U>
+        friend class CCountingAllocator;
+
+        size_t * m_Count;
+    };
+
+    struct TRecord {
+        size_t pos; // position of change in the buffer
+        size_t offset; // position of text in m_Arena
+        uint32_t len;
+        uint32_t group;
+        bool insert;
+    };
+
+    static const size_t m_DefaultLimit = 8 * 1024 * 1024;
+    static const size_t m_MaxCoalesced = 4096; // longer records are not extended anymore
+
+    size_t m_Allocations; // number of blocks allocated by m_Arena and m_Records (must be initialized before them)
+    std::basic_string<char, std::char_traits<char>, CCountingAllocator<char>> m_Arena; // text of all records, in order
+    size_t m_ArenaStart; // bytes at the beginning of arena, that belong to evicted records
+    std::deque<TRecord, CCountingAllocator<TRecord>> m_Records;
+    size_t m_Applied; // number of records, that are applied (records after them can be redone)
+    size_t m_Limit;
+    uint32_t m_Group; // group of the last record
+    unsigned int m_Depth; // number of open groups
+    bool m_Sealed; // true if next record must not be coalesced
+    bool m_Dropped; // true if open group has been evicted (rest of it is not recorded)
+
+    void record(bool insert, size_t pos, const std::string & text);
+
+    /**
+     * Tries to extend the last record by given change.
+     * @return True if change has been coalesced.
+     */
+    bool coalesce(bool insert, size_t pos, const std::string & text);
+
+    /**
+     * Evicts oldest groups until memory usage is under the limit.
+     */
+    void evict();
+
+    /**
+     * Collects records of one group.
+     * @param[in] from Index of first record.
+     * @param[in] to Index after the last record.
+     * @param[in] reverse If true, records are reversed (their changes undo them) and returned from the last one.
+     * @param[out] changes Collected changes.
+     */
+    void collect(size_t from, size_t to, bool reverse, std::vector<TChange> & changes) const;
+};
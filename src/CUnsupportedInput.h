@@ -16,7 +16,8 @@ public:
     CUnsupportedInput & operator = (const CUnsupportedInput &) = delete;
 
     /**
-     * Determines if given char is supported (application can properly display it).
+     * Determines if given char is supported (application can properly display it). Function keys (including
+     * bracketed paste markers) are told from chars by CWindow::tryReadWch() and never get here.
      * @param input Input which should be checked.
      * @return True if input is supported, False if it is not.
      */
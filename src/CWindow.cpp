@@ -25,20 +25,45 @@ CWindow::~CWindow() {
     delwin(m_Window);
 }
 
+std::chrono::steady_clock::duration CWindow::m_FrameInterval = std::chrono::steady_clock::duration::zero();
+std::chrono::steady_clock::time_point CWindow::m_LastUpdate;
+WINDOW * CWindow::m_Input = nullptr;
+
 void CWindow::refreshWindow() {
-    wrefresh(m_Window);
+    wnoutrefresh(m_Window);
+}
+
+void CWindow::touchWindow() {
+    touchwin(m_Window);
+}
+
+void CWindow::updateScreen() {
+    doupdate();
+    m_LastUpdate = std::chrono::steady_clock::now();
+}
+
+void CWindow::setFrameRate(unsigned int fps) {
+    if (fps == 0)
+        m_FrameInterval = std::chrono::steady_clock::duration::zero();
+    else
+        m_FrameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / fps;
 }
 
 int CWindow::readChar() const {
-    return wgetch(m_Window);
+    updateScreen();
+    return wgetch(inputWindow());
 }
 
 void CWindow::printText(const std::wstring & text, unsigned int y, unsigned int x) {
+    printText(text.data(), text.size(), y, x);
+}
+
+void CWindow::printText(const wchar_t * text, size_t len, unsigned int y, unsigned int x) {
     saveCurPos();
     moveCur(y, x);
     unsigned int width = m_HasBox ? m_Width - 1 : m_Width;
-    for (const auto & c  : text) {
-        printChar(c);
+    for (size_t i = 0; i < len; ++i) {
+        printChar(text[i]);
         moveCur(EDirection::RIGHT);
         if (getCurX() >= width) {
             loadCurPos();
@@ -123,13 +148,13 @@ void CWindow::insertNewLine() {
     winsertln(m_Window);
 }
 
-void CWindow::scr(CWindow::EDirection direction) {
+void CWindow::scr(CWindow::EDirection direction, unsigned int distance) {
     switch (direction) {
         case EDirection::UP:
-            wscrl(m_Window, -1);
+            wscrl(m_Window, -(int) distance);
             break;
         case EDirection::DOWN:
-            wscrl(m_Window, 1);
+            wscrl(m_Window, distance);
             break;
         case EDirection::RIGHT:
         case EDirection::LEFT:
@@ -141,6 +166,17 @@ void CWindow::deleteCurLine() {
     wdeleteln(m_Window);
 }
 
+void CWindow::shiftRows(unsigned int y, int count) {
+    saveCurPos();
+    moveCur(y, 0);
+    winsdelln(m_Window, count);
+    loadCurPos();
+}
+
+void CWindow::setHardwareScroll(bool enable) {
+    idlok(m_Window, enable);
+}
+
 void CWindow::eraseLine(unsigned int y) {
     saveCurPos();
     moveCur(y, 0);
@@ -149,20 +185,61 @@ void CWindow::eraseLine(unsigned int y) {
 }
 
 void CWindow::replaceLine(unsigned int y, const std::wstring & text) {
+    replaceLine(y, text.data(), text.size());
+}
+
+void CWindow::replaceLine(unsigned int y, const wchar_t * text, size_t len) {
     eraseLine(y);
-    printText(text, y, 0);
+    printText(text, len, y, 0);
 }
 
 wint_t CWindow::readWch() const {
     wint_t input;
-    wget_wch(m_Window, &input);
+    getWch(input, -1);
     return input;
 }
 
+bool CWindow::tryReadWch(wint_t & input, int timeout) const {
+    return getWch(input, timeout) != ERR;
+}
+
+bool CWindow::tryReadWch(wint_t & input, int timeout, bool & key) const {
+    int res = getWch(input, timeout);
+    key = res == KEY_CODE_YES;
+    return res != ERR;
+}
+
 void CWindow::printHLine(unsigned int y) {
     mvwhline(m_Window, y, 0, ACS_HLINE, m_Width);
 }
 
+int CWindow::getWch(wint_t & input, int timeout) const {
+    int res;
+    // input, that is already waiting, is read without update (if frame has been sent recently or if caller does not wait)
+    WINDOW * window = inputWindow();
+    if (timeout == 0 || std::chrono::steady_clock::now() - m_LastUpdate < m_FrameInterval) {
+        wtimeout(window, 0);
+        res = wget_wch(window, &input);
+        if (res != ERR || timeout == 0) {
+            wtimeout(window, -1);
+            return res;
+        }
+    }
+    updateScreen();
+    wtimeout(window, timeout);
+    res = wget_wch(window, &input);
+    wtimeout(window, -1); // other reads are blocking
+    return res;
+}
+
+WINDOW * CWindow::inputWindow() {
+    if (!m_Input) {
+        m_Input = newpad(1, 1);
+        keypad(m_Input, true);
+    }
+    return m_Input;
+}
+
 void CWindow::saveCurPos() {
     m_tempCurPos = std::make_pair(getCurY(), getCurX());
 }
@@ -199,6 +276,12 @@ void CWindow::setColor(unsigned int y, unsigned int x, int color) {
     loadCurPos();
 }
 
+void CWindow::setRun(unsigned int y, unsigned int x, unsigned int length, int attr, int color) {
+    saveCurPos();
+    mvwchgat(m_Window, y, x, length, attr, color, NULL);
+    loadCurPos();
+}
+
 void CWindow::setLineColor(unsigned int y, int color) {
     saveCurPos();
     mvwchgat(m_Window, y, 0, m_Width, 0, color, NULL);
@@ -8,6 +8,7 @@
 #include <ncurses.h>
 #include <string>
 #include <menu.h>
+#include <chrono>
 
 
 /**
@@ -29,10 +30,30 @@ public:
     CWindow & operator = (const CWindow &) = delete;
 
     /**
-     * Calls wrefres on m_Window
+     * Copies changes of m_Window to the virtual screen (wnoutrefresh). Terminal itself is updated by updateScreen(), which
+     * is called before input is read, so all windows changed during one input are sent to the terminal at once. Window
+     * refreshed last determines cursor position.
      */
     void refreshWindow();
 
+    /**
+     * Marks entire window as changed, so that refreshWindow() copies all of it to the virtual screen (needed when window
+     * overlaps other window, that may have been refreshed over it).
+     */
+    void touchWindow();
+
+    /**
+     * Sends virtual screen (all refreshed windows) to the terminal.
+     */
+    static void updateScreen();
+
+    /**
+     * Limits how often is the terminal updated. When input comes faster, update is postponed until the input stops or
+     * until the frame interval passes (so that the screen is never left outdated while waiting for input).
+     * @param[in] fps Maximal number of updates per second (0 = unlimited, default).
+     */
+    static void setFrameRate(unsigned int fps);
+
     /**
      * Reads one characer from user.
      * @return Character from user (ncurses represents characters as integers).
@@ -47,6 +68,15 @@ public:
      */
     void printText(const std::wstring & text, unsigned int y = 0, unsigned int x = 0);
 
+    /**
+     * Print given chars to given coordinates in m_Window (text is not copied).
+     * @param[in] text Chars to print.
+     * @param[in] len Number of chars.
+     * @param[in] y Y coordinate (in m_Window)
+     * @param[in] x X coordinate (in m_WIndows)
+     */
+    void printText(const wchar_t * text, size_t len, unsigned int y = 0, unsigned int x = 0);
+
     /**
      * Print given string to given coordinates in m_Window. If text is too long for window, it will be cut off.
      * @param[in] text String to print.
@@ -99,8 +129,9 @@ public:
     /**
      * Scrolls window in given dirrecition.
      * @param[in] direction Direction window should be scrolled to.
+     * @param[in] distance Number of rows.
      */
-    void scr(EDirection direction);
+    void scr(EDirection direction, unsigned int distance = 1);
 
     /**
      * Deletes char cursor is currently on.
@@ -129,6 +160,20 @@ public:
      */
     void deleteCurLine();
 
+    /**
+     * Inserts blank rows at given row or deletes rows starting at it, rows below move. Cursor does not move.
+     * @param[in] y Row.
+     * @param[in] count Number of inserted (positive) or deleted (negative) rows.
+     */
+    void shiftRows(unsigned int y, int count);
+
+    /**
+     * Allows ncurses to use insert/delete line and scroll region capabilities of the terminal, so that scrolling and
+     * shiftRows() only send few escape sequences instead of repainting moved rows.
+     * @param[in] enable True to enable, false to disable.
+     */
+    void setHardwareScroll(bool enable);
+
     /**
      * Erases y-th line in the window (counting from 0), will erase part of box as well (use redrawBox() to redraw it).
      * Does note change cursors position.
@@ -143,12 +188,37 @@ public:
      */
     void replaceLine(unsigned int y, const std::wstring & text);
 
+    /**
+     * Replaces text of given line with given chars (text is not copied).
+     * @param[in] y Line to replace.
+     * @param[in] text Chars to print.
+     * @param[in] len Number of chars.
+     */
+    void replaceLine(unsigned int y, const wchar_t * text, size_t len);
+
     /**
      * Reads input from user (one wide char)
      * @return Input from user.
      */
     wint_t readWch() const;
 
+    /**
+     * Reads input from user (one wide char), but waits for it only for given time.
+     * @param[out] input Input from user.
+     * @param[in] timeout Maximal waiting time in milliseconds.
+     * @return True if input has been read, false if user has not typed anything.
+     */
+    bool tryReadWch(wint_t & input, int timeout) const;
+
+    /**
+     * Reads input from user (one wide char), but waits for it only for given time.
+     * @param[out] input Input from user.
+     * @param[in] timeout Maximal waiting time in milliseconds.
+     * @param[out] key True if input is a function key (codes of function keys are the same as codes of some chars).
+     * @return True if input has been read, false if user has not typed anything.
+     */
+    bool tryReadWch(wint_t & input, int timeout, bool & key) const;
+
     /**
      * Prints horizontal line at given line, will erase part of box as well (use redrawBox() to redraw it).
      * @param y Line in window, where horizontal line should be printed.
@@ -189,6 +259,17 @@ public:
      */
     void setColor(unsigned int y, unsigned int x, int color) ;
 
+    /**
+     * Sets given attribute and color to given number of chars (by one call of ncurses). Any already used attributes and
+     * colors of these chars will be replaced.
+     * @param[in] y Y coordinate.
+     * @param[in] x X coordinate of the first char.
+     * @param[in] length Number of chars.
+     * @param[in] attr Attribute to set (as defined by ncurses).
+     * @param[in] color Color pair that should be applied (as specified in CDisplay).
+     */
+    void setRun(unsigned int y, unsigned int x, unsigned int length, int attr, int color);
+
     /**
      * Sets given color to the entire line.
      * @param y Line to which color should be set.
@@ -224,6 +305,27 @@ protected:
     int m_LINES;
     int m_COLS;
 
+    static std::chrono::steady_clock::duration m_FrameInterval; // minimal time between two updates (0 = unlimited)
+    static std::chrono::steady_clock::time_point m_LastUpdate;
+    static WINDOW * m_Input; // pad, from which all input is read (see inputWindow())
+
+    /**
+     * Reads one wide char, terminal is updated first unless timeout is 0 or the last update happened less than
+     * m_FrameInterval ago and input is already waiting.
+     * @param[out] input Read char.
+     * @param[in] timeout How long (in ms) to wait for input (-1 = wait until input comes).
+     * @return Result of wget_wch (ERR if no input came).
+     */
+    int getWch(wint_t & input, int timeout) const;
+
+    /**
+     * Returns window used for reading of input. Reading from a window refreshes it, if it has been changed, which would
+     * send it to the terminal before updateScreen(). Input is therefore read from a pad, that is never changed (pads are
+     * not refreshed by reading), so the terminal is written only by updateScreen().
+     * @return 1x1 pad with keypad enabled (created by the first call).
+     */
+    static WINDOW * inputWindow();
+
     /**
      * Saves current cursor position.
      */
@@ -0,0 +1,195 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CWrapLayout.h"
+
+#include <algorithm>
+
+CWrapLayout::CWrapLayout() : m_Lines(0), m_Width(1), m_IndexValid(false) {}
+
+void CWrapLayout::assign(const std::vector<size_t> & lengths) {
+    m_Chunks.clear();
+    for (size_t first = 0; first < lengths.size(); first += m_ChunkSize) {
+        TChunk chunk;
+        chunk.lengths.assign(lengths.begin() + first, lengths.begin() + std::min(first + m_ChunkSize, lengths.size()));
+        chunk.rows = 0;
+        for (size_t length : chunk.lengths)
+            chunk.rows += rowsOf(length);
+        m_Chunks.push_back(std::move(chunk));
+    }
+    m_Lines = lengths.size();
+    m_IndexValid = false;
+}
+
+void CWrapLayout::clear() {
+    std::vector<TChunk>().swap(m_Chunks); // memory is released, layout is not used until next assign()
+    m_Lines = 0;
+    m_ChunkLines.assign({});
+    m_ChunkRows.assign({});
+    m_IndexValid = false;
+}
+
+void CWrapLayout::setWidth(unsigned int width) {
+    if (width == 0)
+        width = 1;
+    if (width == m_Width)
+        return;
+    m_Width = width;
+    for (auto & chunk : m_Chunks) {
+        chunk.rows = 0;
+        for (size_t length : chunk.lengths)
+            chunk.rows += rowsOf(length);
+    }
+    m_IndexValid = false;
+}
+
+void CWrapLayout::setLength(size_t line, size_t length) {
+    size_t offset;
+    size_t idx = findChunk(line, offset);
+    TChunk & chunk = m_Chunks[idx];
+    long long delta = (long long) rowsOf(length) - (long long) rowsOf(chunk.lengths[offset]);
+    chunk.lengths[offset] = length;
+    chunk.rows += delta;
+    m_ChunkRows.add(idx, delta);
+}
+
+void CWrapLayout::splice(size_t line, size_t erase, size_t insert) {
+    if (m_Chunks.empty()) { // the only chunk is created for inserted lines
+        m_Chunks.push_back(TChunk{{}, 0});
+        m_IndexValid = false;
+    }
+    size_t offset;
+    size_t first = findChunk(line, offset);
+    if (first == m_Chunks.size()) // lines are added behind the last line
+        offset = m_Chunks[--first].lengths.size();
+
+    // erased lines may continue in next chunks, chunks emptied by it are removed afterwards
+    size_t idx = first;
+    for (size_t off = offset; erase > 0 && idx < m_Chunks.size(); ++idx, off = 0) {
+        TChunk & chunk = m_Chunks[idx];
+        size_t take = std::min(erase, chunk.lengths.size() - off);
+        size_t rows = 0;
+        for (size_t i = off; i < off + take; ++i)
+            rows += rowsOf(chunk.lengths[i]);
+        chunk.lengths.erase(chunk.lengths.begin() + off, chunk.lengths.begin() + off + take);
+        chunk.rows -= rows;
+        m_ChunkLines.add(idx, -(long long) take);
+        m_ChunkRows.add(idx, -(long long) rows);
+        m_Lines -= take;
+        erase -= take;
+    }
+
+    TChunk & chunk = m_Chunks[first];
+    chunk.lengths.insert(chunk.lengths.begin() + offset, insert, 0);
+    chunk.rows += insert; // empty line takes one row
+    m_ChunkLines.add(first, insert);
+    m_ChunkRows.add(first, insert);
+    m_Lines += insert;
+
+    while (idx-- > first + 1)
+        fixChunk(idx);
+    fixChunk(first);
+}
+
+size_t CWrapLayout::rows(size_t line) const {
+    size_t offset;
+    size_t idx = findChunk(line, offset);
+    return rowsOf(m_Chunks[idx].lengths[offset]);
+}
+
+size_t CWrapLayout::rowOf(size_t line) const {
+    size_t offset;
+    size_t idx = findChunk(line, offset);
+    if (idx == m_Chunks.size())
+        return totalRows();
+    size_t row = m_ChunkRows.prefix(idx);
+    for (size_t i = 0; i < offset; ++i)
+        row += rowsOf(m_Chunks[idx].lengths[i]);
+    return row;
+}
+
+size_t CWrapLayout::lineOfRow(size_t row, size_t & first) const {
+    buildIndex();
+    size_t idx = m_ChunkRows.lowerBound(row + 1);
+    first = m_ChunkRows.prefix(idx);
+    size_t line = m_ChunkLines.prefix(idx);
+    for (size_t length : m_Chunks[idx].lengths) {
+        size_t rows = rowsOf(length);
+        if (first + rows > row)
+            break;
+        first += rows;
+        ++line;
+    }
+    return line;
+}
+
+size_t CWrapLayout::totalRows() const {
+    buildIndex();
+    return m_ChunkRows.prefix(m_Chunks.size());
+}
+
+size_t CWrapLayout::lineCount() const {
+    return m_Lines;
+}
+
+size_t CWrapLayout::memoryUsage() const {
+    size_t bytes = m_Chunks.capacity() * sizeof(TChunk) + 2 * (m_ChunkLines.size() + 1) * sizeof(size_t);
+    for (const auto & chunk : m_Chunks)
+        bytes += chunk.lengths.capacity() * sizeof(size_t);
+    return bytes;
+}
+
+size_t CWrapLayout::rowsOf(size_t length) const {
+    return length / m_Width + 1;
+}
+
+size_t CWrapLayout::findChunk(size_t line, size_t & offset) const {
+    buildIndex();
+    size_t idx = m_ChunkLines.lowerBound(line + 1);
+    offset = line - m_ChunkLines.prefix(idx);
+    return idx;
+}
+
+void CWrapLayout::fixChunk(size_t chunk) {
+    std::vector<size_t> & lengths = m_Chunks[chunk].lengths;
+    if (lengths.empty()) {
+        m_Chunks.erase(m_Chunks.begin() + chunk);
+        m_IndexValid = false;
+        return;
+    }
+    if (lengths.size() <= 2 * m_ChunkSize)
+        return;
+
+    // chunk is replaced by chunks of m_ChunkSize lines (big paste may need many of them)
+    std::vector<TChunk> parts;
+    for (size_t first = 0; first < lengths.size(); first += m_ChunkSize) {
+        TChunk part;
+        part.lengths.assign(lengths.begin() + first, lengths.begin() + std::min(first + m_ChunkSize, lengths.size()));
+        part.rows = 0;
+        for (size_t length : part.lengths)
+            part.rows += rowsOf(length);
+        parts.push_back(std::move(part));
+    }
+    m_Chunks.erase(m_Chunks.begin() + chunk);
+    m_Chunks.insert(m_Chunks.begin() + chunk, std::make_move_iterator(parts.begin()),
+                    std::make_move_iterator(parts.end()));
+    m_IndexValid = false;
+}
+
+void CWrapLayout::buildIndex() const {
+    if (m_IndexValid)
+        return;
+    std::vector<size_t> lines;
+    std::vector<size_t> rows;
+    lines.reserve(m_Chunks.size());
+    rows.reserve(m_Chunks.size());
+    for (const auto & chunk : m_Chunks) {
+        lines.push_back(chunk.lengths.size());
+        rows.push_back(chunk.rows);
+    }
+    m_ChunkLines.assign(lines);
+    m_ChunkRows.assign(rows);
+    m_IndexValid = true;
+}
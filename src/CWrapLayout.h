@@ -0,0 +1,128 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include "CFenwickTree.h"
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Layout of soft-wrapped text: every line is split into rows of given width. Line of length len takes len / width + 1
+ * rows (there is always a place for the cursor behind the last char). Lengths of lines are stored in chunks of at most
+ * 2 * m_ChunkSize lines, every chunk keeps number of it's rows. Numbers of lines and rows of chunks are kept in
+ * CFenwickTrees, so conversion between rows and lines is O(log n + m_ChunkSize). Adding, removing or changing of a line
+ * changes only it's chunk, the trees are rebuilt (O(n / m_ChunkSize)) only when a chunk is split or removed.
+ */
+class CWrapLayout {
+public:
+    CWrapLayout();
+
+    /**
+     * Replaces all lines by lines with given lengths.
+     * @param[in] lengths Number of chars on every line.
+     */
+    void assign(const std::vector<size_t> & lengths);
+
+    /**
+     * Removes all lines (layout is not used).
+     */
+    void clear();
+
+    /**
+     * Sets width of rows (for example after resize of the editor).
+     * @param[in] width Number of chars on one row (at least 1).
+     */
+    void setWidth(unsigned int width);
+
+    /**
+     * Sets length of given line.
+     * @param[in] line Index of line (line must exist).
+     * @param[in] length Number of chars on the line.
+     */
+    void setLength(size_t line, size_t length);
+
+    /**
+     * Replaces given number of lines by given number of new lines, length of new lines is 0 (use setLength()).
+     * @param[in] line Index of first replaced line.
+     * @param[in] erase Number of lines to remove.
+     * @param[in] insert Number of lines to insert.
+     */
+    void splice(size_t line, size_t erase, size_t insert);
+
+    /**
+     * @param[in] line Index of line (line must exist).
+     * @return Number of rows of given line.
+     */
+    size_t rows(size_t line) const;
+
+    /**
+     * @param[in] line Index of line (number of lines for the row behind the last line).
+     * @return Index of first row of given line.
+     */
+    size_t rowOf(size_t line) const;
+
+    /**
+     * Finds line, that contains given row.
+     * @param[in] row Index of row (must be smaller than totalRows()).
+     * @param[out] first Index of first row of the found line.
+     * @return Index of line.
+     */
+    size_t lineOfRow(size_t row, size_t & first) const;
+
+    /**
+     * @return Number of rows of all lines.
+     */
+    size_t totalRows() const;
+
+    /**
+     * @return Number of lines.
+     */
+    size_t lineCount() const;
+
+    /**
+     * @return Bytes used by the layout.
+     */
+    size_t memoryUsage() const;
+
+private:
+    struct TChunk {
+        std::vector<size_t> lengths; // number of chars on every line of the chunk
+        size_t rows; // number of rows of all lines of the chunk
+    };
+
+    static const size_t m_ChunkSize = 256; // number of lines of a new chunk, chunk is split when it has twice as many
+
+    std::vector<TChunk> m_Chunks; // lines in order (there are no empty chunks)
+    size_t m_Lines; // number of lines
+    unsigned int m_Width;
+    mutable CFenwickTree m_ChunkLines; // number of lines of every chunk
+    mutable CFenwickTree m_ChunkRows; // number of rows of every chunk
+    mutable bool m_IndexValid; // false if chunks were added or removed since the trees have been built
+
+    /**
+     * @return Number of rows of line of given length.
+     */
+    size_t rowsOf(size_t length) const;
+
+    /**
+     * Finds chunk, that contains given line.
+     * @param[in] line Index of line (number of lines for the position behind the last line).
+     * @param[out] offset Index of the line in the chunk.
+     * @return Index of chunk (number of chunks if there are no lines).
+     */
+    size_t findChunk(size_t line, size_t & offset) const;
+
+    /**
+     * Splits given chunk, if it is too big, and removes it, if it is empty.
+     */
+    void fixChunk(size_t chunk);
+
+    /**
+     * Rebuilds trees if they are not valid.
+     */
+    void buildIndex() const;
+};
@@ -1,6 +1,8 @@
 #include "CApplication.h"
 
-int main() {
+int main(int argc, char * argv[]) {
+    if (!CApplication::parseArgs(argc, argv))
+        return 1;
     CApplication application;
     application.run();
     return 0;
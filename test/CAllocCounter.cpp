@@ -0,0 +1,41 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CAllocCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+thread_local uint64_t CAllocCounter::m_Count = 0;
+
+uint64_t CAllocCounter::count() {
+    return m_Count;
+}
+
+void CAllocCounter::record() {
+    ++m_Count;
+}
+
+// array and nothrow versions of new and delete call these by default
+void * operator new(std::size_t size) {
+    CAllocCounter::record();
+    void * ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    CAllocCounter::record();
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void * ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
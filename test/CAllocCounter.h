@@ -0,0 +1,31 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Counts heap allocations done by global operator new (it is replaced in CAllocCounter.cpp, which is linked only to
+ * tests, the application keeps the default allocator). Every thread has it's own counter, so allocations of background
+ * threads (loader, highlighter) are not mixed with allocations of the editor.
+ */
+class CAllocCounter {
+public:
+    CAllocCounter() = delete;
+
+    /**
+     * @return Number of allocations done by calling thread since it has been started.
+     */
+    static uint64_t count();
+
+    /**
+     * Counts one allocation of calling thread (called by operator new).
+     */
+    static void record();
+
+private:
+    static thread_local uint64_t m_Count;
+};
@@ -0,0 +1,207 @@
+/**
+ * @author Jakub Kuchejda <kuchejak@fit.cvut.cz>
+ * @date 16.10.26
+ */
+
+#include "CAllocCounter.h"
+#include "CTextStorage.h"
+#include "CWindow.h"
+#include "CMarkdown.h"
+#include "CHighlighter.h"
+
+#include <ncurses.h>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// budget of heap allocations of the editor thread per key (from the action to the refresh of the frame), snapshot of
+// the text for CHighlighter takes 3 of them, the rest (growth of pieces, undo log) is rare
+static const double AverageBudget = 3.2;
+static const uint64_t MaxBudget = 10;
+
+/**
+ * Editor without user interface: keys are applied to CTextStorage and rendered to window in the same way as in
+ * CTextEditor (damaged rows are repainted, formatting is computed by CHighlighter with CMarkdown).
+ */
+class CSession {
+public:
+    CSession() : m_Storage(0), m_Window(LINES, COLS), m_Highlighter(m_Format) {}
+
+    bool load(const std::string & fileName) {
+        if (!m_Storage.load(fileName))
+            return false;
+        m_Storage.damageAll();
+        render();
+        return true;
+    }
+
+    /**
+     * Handles one key ('\n' = Enter, '\b' = Backspace, other chars are typed), renders the frame and waits until it's
+     * formatting is shown.
+     * @return Number of allocations of the editor thread.
+     */
+    uint64_t key(wchar_t key) {
+        uint64_t start = CAllocCounter::count();
+        size_t line = m_Storage.convertScreenY(m_Y);
+        size_t col = m_Storage.convertScreenX(m_Y, m_X);
+        if (key == L'\n') {
+            m_Storage.moveEndOfLineDown(m_Y, m_X);
+            m_Storage.moveTo(line + 1, 0, m_Y, m_X);
+        }
+        else if (key == L'\b' && col > 0) {
+            m_Storage.moveTo(line, col - 1, m_Y, m_X);
+            m_Storage.delChar(m_Y, m_X);
+        }
+        else if (key == L'\b' && line > 0) {
+            size_t end = m_Storage.endOfPrevLine(m_Y);
+            m_Storage.moveLineUp(m_Y); // join line to line above
+            m_Storage.moveTo(line - 1, end, m_Y, m_X);
+        }
+        else if (key != L'\b') {
+            std::wstring text(1, key);
+            m_Storage.inputText(text, m_Y, m_X);
+            m_Storage.moveTo(line, col + 1, m_Y, m_X);
+        }
+        render();
+        return CAllocCounter::count() - start;
+    }
+
+    /**
+     * Moves cursor to given position (it is not counted as a key).
+     */
+    void moveTo(size_t line, size_t col) {
+        m_Storage.moveTo(line, col, m_Y, m_X);
+        render();
+    }
+
+private:
+    CTextStorage m_Storage;
+    CWindow m_Window;
+    CMarkdown m_Format;
+    CHighlighter m_Highlighter;
+    std::vector<CLineStates::TSplice> m_Splices;
+    unsigned int m_Y = 0;
+    unsigned int m_X = 0;
+
+    void render() {
+        CTextStorage::TScroll scroll;
+        unsigned int from = 0, to = 0;
+        bool scrolled = m_Storage.takeScroll(scroll);
+        if (m_Storage.takeDamage(from, to) && scrolled) { // scrolled screen is repainted entirely
+            from = 0;
+            to = m_Window.getHeight();
+        }
+        m_Storage.visitScreenLines(from, to, [this](unsigned int y, CTextStorage::TLineView line) {
+            m_Window.replaceLine(y, line.text, line.len);
+        });
+
+        size_t first = m_Storage.convertScreenY(0);
+        size_t last = m_Storage.convertScreenY(m_Window.getHeight() - 1);
+        m_Storage.takeSplices(m_Splices);
+        m_Highlighter.request(m_Storage.snapshot(last + CHighlighter::m_Margin), m_Storage.revision(), m_Splices,
+                              first, last);
+        while (m_Highlighter.pending()) {
+            if (!m_Highlighter.update()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            for (unsigned int y = 0; y < m_Window.getHeight(); ++y) {
+                auto spans = m_Highlighter.spans(m_Storage.convertScreenY(y), m_Storage.revision());
+                if (spans)
+                    CFormat::applySpans(m_Storage, m_Window, y, *spans);
+            }
+        }
+        m_Window.moveCur(m_Y, m_X);
+        m_Window.refreshWindow();
+        CWindow::updateScreen();
+    }
+};
+
+/**
+ * Writes markdown note used by the session.
+ * @return Name of the file (empty if it could not be created).
+ */
+static std::string createNote() {
+    char fileName[] = "/tmp/allocBudgetXXXXXX";
+    int fd = mkstemp(fileName);
+    if (fd < 0)
+        return "";
+    std::string text;
+    for (int i = 0; i < 300; ++i) {
+        if (i % 25 == 0)
+            text += "# Heading " + std::to_string(i) + "\n";
+        else if (i % 7 == 0)
+            text += "1. list item with **bold** and _italic_ words\n";
+        else
+            text += "Plain line " + std::to_string(i) + " of the note with *emphasis* and some more text.\n";
+    }
+    bool written = write(fd, text.data(), text.size()) == (ssize_t) text.size();
+    close(fd);
+    if (!written) {
+        unlink(fileName);
+        return "";
+    }
+    return fileName;
+}
+
+int main() {
+    setlocale(LC_ALL, "");
+    FILE * out = fopen("/dev/null", "w");
+    SCREEN * screen = newterm("xterm-256color", out, stdin); // off-screen terminal, output is thrown away
+    if (!screen) {
+        fprintf(stderr, "allocBudget: terminal could not be created\n");
+        return 2;
+    }
+    start_color();
+    std::string fileName = createNote();
+    if (fileName.empty()) {
+        endwin();
+        fprintf(stderr, "allocBudget: note could not be created\n");
+        return 2;
+    }
+
+    const std::wstring script = L"Typing **bold text** and _italic_ words into the note.\n"
+                                L"- new list item\n\n"
+                                L"```\ncode block\n```\n"
+                                L"Mistakes get fixxx\b\b\bxed, lines get joined.\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b";
+    uint64_t keys = 0, total = 0, max = 0;
+    {
+        CSession session;
+        if (!session.load(fileName)) {
+            endwin();
+            fprintf(stderr, "allocBudget: note could not be loaded\n");
+            return 2;
+        }
+        for (size_t round = 0; round < 4; ++round) {
+            session.moveTo(round * 90, 10); // start of the document, middle and end
+            for (wchar_t c : script) {
+                uint64_t allocs = session.key(c);
+                if (round == 0) // buffers of the storage, window and highlighter grow during the first round
+                    continue;
+                ++keys;
+                total += allocs;
+                max = std::max(max, allocs);
+            }
+        }
+    }
+    endwin();
+    delscreen(screen);
+    fclose(out);
+    unlink(fileName.c_str());
+
+    double average = (double) total / keys;
+    printf("allocBudget: %llu keys, %.2f allocations per key on average (budget %.2f), at most %llu (budget %llu)\n",
+           (unsigned long long) keys, average, AverageBudget, (unsigned long long) max,
+           (unsigned long long) MaxBudget);
+    if (average > AverageBudget || max > MaxBudget) {
+        fprintf(stderr, "allocBudget: allocation budget exceeded\n");
+        return 1;
+    }
+    return 0;
+}